@@ -0,0 +1,115 @@
+#include "src/definitions.h"
+#include "src/mmu.h"
+#include "src/cpu.h"
+#include "src/ppu.h"
+#include "src/jit.h"
+
+#include <chrono>
+#include <random>
+
+/*
+	Renders frames of random tiles, maps and sprites with the background,
+	window and 8x16 sprites on, once with the tile cache warm and once with
+	every tile decoded again each frame, for each kernel set the CPU
+	supports. Frames have to match the scalar ones.
+*/
+static int benchmarkKernels(int frames) {
+    MMU* mmu = new MMU();
+    PPU* ppu = new PPU(mmu);
+    std::mt19937 random(1);
+    for (uint16_t address = 0x8000; address < 0xA000; address++) mmu->set(address, random());
+    for (uint16_t address = 0xFE00; address < 0xFEA0; address++) mmu->set(address, random());
+    mmu->memory[0xFF40] = 0xF7;
+    mmu->memory[0xFF47] = 0xE4;
+    mmu->memory[0xFF48] = 0xD2;
+    mmu->memory[0xFF49] = 0x1B;
+    mmu->memory[0xFF4A] = 72;
+    mmu->memory[0xFF4B] = 87;
+
+    std::vector<uint16_t> reference;
+    for (const PixelKernels* kernels : supportedKernels()) {
+        ppu->kernels = kernels;
+        double times[2];
+        for (int pass = 0; pass < 2; pass++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frames; frame++) {
+                if (pass == 1) mmu->dirtyTiles.set();
+                // SCX/SCY move so every frame samples other tiles
+                mmu->memory[0xFF42] = static_cast<uint8_t>(frame);
+                mmu->memory[0xFF43] = static_cast<uint8_t>(frame * 3);
+                for (int line = 0; line < GB_HEIGHT; line++) {
+                    ppu->startLine(line, 0);
+                    ppu->endLine();
+                }
+                ppu->finishFrame();
+            }
+            std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+            times[pass] = elapsed.count() / frames;
+        }
+        std::vector<uint16_t> image(ppu->frame(), ppu->frame() + GB_WIDTH * GB_HEIGHT);
+        if (reference.empty()) reference = image;
+        char message[120];
+        snprintf(message, sizeof(message), "%-6s %8.2f us/frame cached, %8.2f us/frame decoding every tile%s",
+            kernels->name, times[0], times[1], image == reference ? "" : ", FRAMES DIFFER FROM SCALAR");
+        PrintMessage(Info, message);
+        if (image != reference) return -1;
+    }
+    return 0;
+}
+
+// Frontend without video or SDL, for running ROMs on machines without a display
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        PrintMessage(Error, "Usage: gbemu-headless <rom> [--jit | --jit-verify] [--boot <boot rom>] [--fifo-ppu] [--frames <count>]");
+        PrintMessage(Error, "       gbemu-headless --bench-ppu [frames]");
+        return -1;
+    }
+    if (std::string(argv[1]) == "--bench-ppu") return benchmarkKernels(argc > 2 ? std::stoi(argv[2]) : 2000);
+    MMU* mmu = new MMU();
+    if (!mmu->load(argv[1])) return -1;
+    // A boot ROM has to be mapped before the CPU starts at 0x0000
+    for (int i = 2; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--boot" && !mmu->loadBootRom(argv[i + 1])) return -1;
+    }
+    PPU* ppu = new PPU(mmu);
+    // The dot accurate renderer is picked before anything runs, the JIT's shadow copies it
+    for (int i = 2; i < argc; i++) {
+        if (std::string(argv[i]) == "--fifo-ppu") ppu->attach<FifoRenderer>();
+    }
+    CPU* cpu = new CPU(mmu);
+
+    // Optional flags after the ROM path, without --frames it runs until killed
+    Jit* jit = NULL;
+    uint64_t limit = 0;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--jit") jit = new Jit(cpu);
+        else if (arg == "--jit-verify") jit = new Jit(cpu, true);
+        else if (arg == "--boot") i++;
+        else if (arg == "--frames" && i + 1 < argc) limit = std::stoull(argv[++i]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t frames = 0;
+    while (limit == 0 || frames < limit) {
+        if (jit != NULL) {
+            jit->runFrame();
+        }
+        else {
+            cpu->runFrame();
+        }
+        // Between frames is an idle point, hand the save's dirty pages to the OS about once a second
+        if (++frames % 60 == 0) mmu->flushSave();
+    }
+    mmu->flushSave();
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    PrintMessage(Info, "Ran " + std::to_string(frames) + " frames in " + std::to_string(elapsed.count()) + " s");
+    if (jit != NULL && jit->verify) {
+        PrintMessage(Info, "JIT mismatches " + std::to_string(jit->mismatches));
+        if (jit->mismatches > 0) return 1;
+    }
+
+    return 0;
+}
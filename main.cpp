@@ -5,6 +5,8 @@
 #include "src/mmu.h"
 #include "src/cpu.h"
 #include "src/ppu.h"
+#include "src/display.h"
+#include "src/jit.h"
 
 #include <cstdio>
 #include <SDL.h>
@@ -17,7 +19,7 @@ int main(int argc, char* argv[])
         printf("Failed to initialize: %s\n", SDL_GetError());
         return -1;
     }
-    //SDL_Window* window = SDL_CreateWindow("gbemu", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, GB_HEIGHT * 4, GB_WIDTH * 4, NULL);
+    //SDL_Window* window = SDL_CreateWindow("gbemu", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, GB_WIDTH * 4, GB_HEIGHT * 4, NULL);
     //SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
     //if (renderer == NULL) {
     //    SDL_Log("Failed to create SDL renderer");
@@ -31,13 +33,36 @@ int main(int argc, char* argv[])
     //ImGui_ImplSDL2_InitForSDLRenderer(window, renderer);
     //ImGui_ImplSDLRenderer_Init(renderer);
     
+    if (argc < 2) {
+        PrintMessage(Error, "Usage: gbemu <rom> [--jit | --jit-verify] [--boot <boot rom>] [--fifo-ppu]");
+        return -1;
+    }
     MMU* mmu = new MMU();
-    mmu->load(argv[1]);
-    PPU* ppu = new PPU(const_cast<char*>(mmu->title.c_str()));
+    if (!mmu->load(argv[1])) return -1;
+    // A boot ROM has to be mapped before the CPU starts at 0x0000
+    for (int i = 2; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--boot" && !mmu->loadBootRom(argv[i + 1])) return -1;
+    }
+    PPU* ppu = new PPU(mmu);
+    // The dot accurate renderer is picked before anything runs, the JIT's shadow copies it
+    for (int i = 2; i < argc; i++) {
+        if (std::string(argv[i]) == "--fifo-ppu") ppu->attach<FifoRenderer>();
+    }
+    Display* display = new Display(mmu->title.c_str());
     CPU* cpu = new CPU(mmu);
 
+    // Optional flags after the ROM path
+    Jit* jit = NULL;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--jit") jit = new Jit(cpu);
+        else if (arg == "--jit-verify") jit = new Jit(cpu, true);
+        else if (arg == "--boot") i++;
+    }
+
     // Main event loop
     bool end = false;
+    uint64_t frames = 0;
     while (!end) {
         /*SDL_Event event;
         while (SDL_PollEvent(&event))
@@ -47,18 +72,26 @@ int main(int argc, char* argv[])
                 end = true;
         }*/
         
-        cpu->cycle();
+        if (jit != NULL) {
+            jit->runFrame();
+        }
+        else {
+            cpu->runFrame();
+        }
+        display->present(ppu->frame());
+        // Between frames is an idle point, hand the save's dirty pages to the OS about once a second
+        if (++frames % 60 == 0) mmu->flushSave();
         /*ImGui_ImplSDLRenderer_NewFrame();
         ImGui_ImplSDL2_NewFrame();
         ImGui::NewFrame();
         ImGui::Begin("CPU");
-        ImGui::Text("AF %02X", cpu->AF.getRegister());
-        ImGui::Text("BC %02X", cpu->BC.getRegister());
-        ImGui::Text("DE %02X", cpu->DE.getRegister());
-        ImGui::Text("HL %02X", cpu->HL.getRegister());
+        ImGui::Text("AF %02X", cpu->AF);
+        ImGui::Text("BC %02X", cpu->BC);
+        ImGui::Text("DE %02X", cpu->DE);
+        ImGui::Text("HL %02X", cpu->HL);
         ImGui::Text("SP %02X", cpu->sp);
         ImGui::Text("PC %02X", cpu->pc);
-        ImGui::Text("Cycles %2X", cpu->cycles);
+        ImGui::Text("Cycles %llX", mmu->scheduler.now);
         ImGui::End();
         ImGui::Begin("FLAGS");
         ImGui::Text("Z %X", cpu->getFlag(cpu->FLAG_Z));
@@ -78,6 +111,7 @@ int main(int argc, char* argv[])
     /*ImGui_ImplSDLRenderer_Shutdown();
     ImGui_ImplSDL2_Shutdown();
     ImGui::DestroyContext();*/
+    delete display;
     SDL_Quit();
 
     return 0;
@@ -0,0 +1,256 @@
+#include "blockcache.h"
+
+#include <algorithm>
+
+BlockCache::BlockCache(MMU* mmu) {
+	this->mmu = mmu;
+	memset(lookup, 0, sizeof(lookup));
+	scratch.valid = true;
+	scratch.hits = 0;
+	scratch.native = NULL;
+	scratch.instructions.reserve(1);
+}
+
+BlockCache::~BlockCache() {
+	flush();
+	for (Block* block : retired) delete block;
+}
+
+static bool isBlockTerminator(uint8_t opcode) {
+	switch (opcode) {
+	case 0x10: // STOP
+	case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: // JR
+	case 0x76: // HALT
+	case 0xC0: case 0xC8: case 0xC9: case 0xD0: case 0xD8: case 0xD9: // RET
+	case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: case 0xE9: // JP
+	case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC: // CALL
+	case 0xC7: case 0xCF: case 0xD7: case 0xDF: // RST
+	case 0xE7: case 0xEF: case 0xF7: case 0xFF:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Instructions that only read memory and change registers or flags
+static bool isSideEffectFree(const DecodedInstruction& inst) {
+	uint8_t op = inst.opcode;
+	if (op == 0xCB) {
+		// Everything but BIT on (HL) writes memory when it targets (HL)
+		return (inst.operand & 0x07) != 6 || (inst.operand >= 0x40 && inst.operand < 0x80);
+	}
+	if (op >= 0x40 && op < 0x80) return op < 0x70 || op > 0x77; // LD r,r' but not LD (HL),r or HALT
+	if (op >= 0x80 && op < 0xC0) return true; // ALU A,r
+	switch (op) {
+	case 0x00: // NOP
+	case 0x0A: case 0x1A: case 0xF0: case 0xF2: case 0xFA: // LD A,(mem)
+	case 0xC6: case 0xCE: case 0xD6: case 0xDE: // ALU A,d8
+	case 0xE6: case 0xEE: case 0xF6: case 0xFE:
+	case 0x07: case 0x0F: case 0x17: case 0x1F: // RLCA, RRCA, RLA, RRA
+	case 0x27: case 0x2F: case 0x37: case 0x3F: // DAA, CPL, SCF, CCF
+		return true;
+	default:
+		// INC/DEC r and LD r,d8 other than on (HL), INC/DEC rr
+		if (op < 0x40 && (op & 0x07) >= 4 && (op & 0x07) <= 6) return (op & 0x38) != 0x30;
+		return op < 0x40 && (op & 0x07) == 3;
+	}
+}
+
+/*
+	An idle loop is a block that branches back to its own start and 
+	otherwise only reads memory and computes, like the usual LY or STAT 
+	poll. The CPU can skip its passes while nothing it reads changes, see 
+	CPU::skipIdleLoop.
+*/
+uint32_t BlockCache::idleLoopCycles(const Block* block) {
+	const DecodedInstruction& branch = block->instructions.back();
+	uint32_t target;
+	switch (branch.opcode) {
+	case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: // JR
+		target = (branch.address + 2 + static_cast<int8_t>(branch.operand)) & 0xFFFF;
+		break;
+	case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA: // JP
+		target = branch.operand;
+		break;
+	default:
+		return 0;
+	}
+	if (target != block->start) return 0;
+	uint32_t cycles = branch.cycles;
+	for (size_t i = 0; i + 1 < block->instructions.size(); i++) {
+		if (!isSideEffectFree(block->instructions[i])) return 0;
+		cycles += block->instructions[i].cycles;
+	}
+	return cycles;
+}
+
+uint16_t BlockCache::getBank(uint16_t pc) {
+	if (pc < 0x4000) return mmu->lowRomBank;
+	if (pc < 0x8000) return mmu->romBank;
+	return 0;
+}
+
+bool BlockCache::isCacheable(uint16_t pc) {
+	// IO registers change underneath the CPU without going through MMU::set, 
+	// and cartridge RAM is banked without any write
+	return (pc < 0xA000 || pc >= 0xC000) && (pc < 0xFF00 || pc >= 0xFF80);
+}
+
+bool BlockCache::isBreakpoint(uint16_t pc) {
+	return (mmu->pageFlags[pc >> 8] & PAGE_BREAKPOINT) && mmu->breakpoints.test(pc);
+}
+
+void BlockCache::decode(Block* block, uint16_t pc, int limit) {
+	block->start = pc;
+	block->breakpoint = isBreakpoint(pc);
+	block->instructions.clear();
+	uint32_t address = pc;
+	for (int i = 0; i < limit; i++) {
+		DecodedInstruction inst;
+		inst.address = static_cast<uint16_t>(address);
+		inst.opcode = mmu->peek(static_cast<uint16_t>(address));
+		inst.length = opcodeLengths[inst.opcode];
+		inst.operand = 0;
+		if (inst.length > 1) inst.operand = mmu->peek(static_cast<uint16_t>(address + 1));
+		if (inst.length > 2) inst.operand |= mmu->peek(static_cast<uint16_t>(address + 2)) << 8;
+		inst.cycles = opcodeTimings[inst.opcode];
+		if (inst.opcode == 0xCB) inst.cycles += opcodeExtendedTimings[inst.operand];
+		inst.fusion = FUSION_NONE;
+		block->instructions.push_back(inst);
+		address += inst.length;
+		// Stop at control flow and never run across a 16 KB window, into IO 
+		// or onto a breakpoint
+		if (isBlockTerminator(inst.opcode) || (address & 0x1C000) != (pc & 0xC000) 
+			|| !isCacheable(static_cast<uint16_t>(address)) || isBreakpoint(static_cast<uint16_t>(address))) {
+			break;
+		}
+	}
+	block->end = address;
+	block->loopCycles = idleLoopCycles(block);
+	fuse(block);
+}
+
+// Opcodes of each fused sequence, indexed by Fusion
+static const uint8_t fusionOpcodes[FUSION_COUNT][4] = {
+	{ 0 },
+	{ 2, 0x2A, 0x12 },
+	{ 2, 0x05, 0x20 },
+	{ 2, 0x0D, 0x20 },
+	{ 3, 0xF0, 0xE6, 0x28 },
+	{ 3, 0xF0, 0xE6, 0x20 }
+};
+
+void BlockCache::fuse(Block* block) {
+	std::vector<DecodedInstruction>& instructions = block->instructions;
+	for (size_t i = 0; i < instructions.size(); i++) {
+		if (!startsFusion(instructions[i].opcode)) continue;
+		for (int fusion = FUSION_NONE + 1; fusion < FUSION_COUNT; fusion++) {
+			size_t length = fusionOpcodes[fusion][0];
+			if (i + length > instructions.size()) continue;
+			size_t j = 0;
+			while (j < length && instructions[i + j].opcode == fusionOpcodes[fusion][j + 1]) j++;
+			if (j == length) {
+				instructions[i].fusion = static_cast<uint8_t>(fusion);
+				break;
+			}
+		}
+	}
+}
+
+Block* BlockCache::fetch(uint16_t pc) {
+	for (Block* block : retired) delete block;
+	retired.clear();
+
+	// During OAM DMA everything below IO reads as open bus, which must not be cached
+	if (!isCacheable(pc) || (mmu->dmaActive && pc < 0xFF00)) {
+		decode(&scratch, pc, 1);
+		return &scratch;
+	}
+
+	uint16_t bank = getBank(pc);
+	Block* block = lookup[pc];
+	if (block != NULL && block->bank == bank) return block;
+
+	uint32_t key = static_cast<uint32_t>(bank) << 16 | pc;
+	auto it = blocks.find(key);
+	if (it != blocks.end()) {
+		lookup[pc] = it->second;
+		return it->second;
+	}
+
+	block = new Block();
+	block->bank = bank;
+	block->valid = true;
+	block->hits = 0;
+	block->native = NULL;
+	decode(block, pc, BLOCK_MAX_INSTRUCTIONS);
+	blocks[key] = block;
+	lookup[pc] = block;
+	// Register the block with every page it covers so writes can find it
+	for (uint32_t page = block->start >> 8; page <= (block->end - 1) >> 8; page++) {
+		pages[page & 0xFF].push_back(block);
+		mmu->markCode(page & 0xFF, true);
+	}
+	return block;
+}
+
+// The scratch block used for uncacheable addresses is rebuilt on every fetch
+bool BlockCache::isCached(const Block* block) {
+	return block != &scratch;
+}
+
+void BlockCache::retire(Block* block) {
+	block->valid = false;
+	blocks.erase(static_cast<uint32_t>(block->bank) << 16 | block->start);
+	if (lookup[block->start] == block) lookup[block->start] = NULL;
+	for (uint32_t page = block->start >> 8; page <= (block->end - 1) >> 8; page++) {
+		std::vector<Block*>& list = pages[page & 0xFF];
+		list.erase(std::find(list.begin(), list.end(), block));
+		if (list.empty()) mmu->markCode(page & 0xFF, false);
+	}
+	// Blocks are only freed on the next fetch, the CPU may still be inside one
+	retired.push_back(block);
+}
+
+void BlockCache::invalidate(uint16_t address) {
+	uint16_t bank = getBank(address);
+	hits.clear();
+	for (Block* block : pages[address >> 8]) {
+		// Blocks of other ROM banks share the window but were not written. A 
+		// block spilling in from the previous window is always affected.
+		uint32_t offset = (address - block->start) & 0xFFFF;
+		if (offset < block->end - block->start 
+			&& (block->bank == bank || (block->start & 0xC000) != (address & 0xC000))) {
+			hits.push_back(block);
+		}
+	}
+	for (Block* block : hits) retire(block);
+}
+
+/*
+	The window holding address was switched to another bank. Blocks of the
+	old bank are still right for it, but the instruction at address may be
+	in the middle of one, so those covering it are dropped to end the block.
+*/
+void BlockCache::remap(uint16_t address) {
+	uint16_t bank = getBank(address);
+	hits.clear();
+	for (Block* block : pages[address >> 8]) {
+		uint32_t offset = (address - block->start) & 0xFFFF;
+		if (offset < block->end - block->start && block->bank != bank) hits.push_back(block);
+	}
+	for (Block* block : hits) retire(block);
+}
+
+void BlockCache::flush() {
+	for (auto& entry : blocks) {
+		entry.second->valid = false;
+		retired.push_back(entry.second);
+	}
+	blocks.clear();
+	memset(lookup, 0, sizeof(lookup));
+	for (int page = 0; page < 0x100; page++) {
+		pages[page].clear();
+		mmu->markCode(page, false);
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "definitions.h"
+#include "mmu.h"
+
+#include <vector>
+#include <unordered_map>
+
+class CPU;
+
+const int BLOCK_MAX_INSTRUCTIONS = 32;
+
+typedef void (*NativeBlock)(CPU* cpu);
+
+/*
+	Short sequences common in hot loops that the interpreter runs as one 
+	handler. The kind is recorded on the first instruction of the sequence.
+*/
+enum Fusion {
+	FUSION_NONE,
+	FUSION_COPY,       // LD A,(HL+) + LD (DE),A
+	FUSION_DEC_B_LOOP, // DEC B + JR NZ,e
+	FUSION_DEC_C_LOOP, // DEC C + JR NZ,e
+	FUSION_POLL_Z,     // LDH A,(n) + AND d8 + JR Z,e
+	FUSION_POLL_NZ,    // LDH A,(n) + AND d8 + JR NZ,e
+	FUSION_COUNT
+};
+
+// Opcodes a fused sequence can start with
+constexpr bool startsFusion(uint8_t opcode) {
+	return opcode == 0x2A || opcode == 0x05 || opcode == 0x0D || opcode == 0xF0;
+}
+
+struct DecodedInstruction {
+	uint16_t address;
+	uint16_t operand; // Immediate byte/word, or the second byte of a CB opcode
+	uint8_t opcode;
+	uint8_t length;
+	uint8_t cycles;   // Including the extended timing of CB opcodes
+	uint8_t fusion;   // Fusion starting here, FUSION_NONE for most
+};
+
+struct Block {
+	uint16_t start;
+	uint32_t end;     // One past the last byte covered by the block
+	uint16_t bank;
+	bool valid;
+	uint32_t hits;      // Executions, used by the JIT to find hot blocks
+	NativeBlock native; // Translated code, NULL while interpreted
+	uint32_t loopCycles; // M-cycles of one pass if this is an idle loop, else 0
+	bool breakpoint;     // Starts on a breakpoint, see MMU::breakpoints
+	std::vector<DecodedInstruction> instructions;
+};
+
+/*
+	Cache of predecoded basic blocks keyed by (ROM bank, PC). A block runs up 
+	to the first control flow instruction. MMU::set reports writes to pages 
+	that hold cached code, so blocks in RAM (or anything rewritten through the 
+	flat memory array) are dropped as soon as their bytes change.
+*/
+class BlockCache {
+public:
+	BlockCache(MMU* mmu);
+	~BlockCache();
+
+	Block* fetch(uint16_t pc);
+	bool isCached(const Block* block);
+	void invalidate(uint16_t address);
+	void remap(uint16_t address);
+	void flush();
+
+private:
+	MMU* mmu;
+
+	Block* lookup[0x10000];
+	std::unordered_map<uint32_t, Block*> blocks;
+	std::vector<Block*> pages[0x100];
+	std::vector<Block*> retired;
+	std::vector<Block*> hits;
+	Block scratch;
+
+	uint16_t getBank(uint16_t pc);
+	bool isCacheable(uint16_t pc);
+	bool isBreakpoint(uint16_t pc);
+	void decode(Block* block, uint16_t pc, int limit);
+	uint32_t idleLoopCycles(const Block* block);
+	void fuse(Block* block);
+	void retire(Block* block);
+};
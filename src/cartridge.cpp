@@ -0,0 +1,240 @@
+#include "cartridge.h"
+#include "mmu.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::shared_ptr<RomImage> RomImage::open(const std::string& file) {
+	std::shared_ptr<RomImage> image(new RomImage());
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE) {
+		PrintMessage(Error, "Could not open " + file);
+		return NULL;
+	}
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(handle, &fileSize);
+	image->mapped = static_cast<size_t>(fileSize.QuadPart);
+	// The view keeps the mapping alive, neither handle is needed afterwards
+	HANDLE mapping = image->mapped > 0 ? CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	if (mapping != NULL) {
+		image->bytes = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		CloseHandle(mapping);
+	}
+	CloseHandle(handle);
+#else
+	int handle = ::open(file.c_str(), O_RDONLY);
+	if (handle < 0) {
+		PrintMessage(Error, "Could not open " + file);
+		return NULL;
+	}
+	struct stat info;
+	if (fstat(handle, &info) == 0) image->mapped = static_cast<size_t>(info.st_size);
+	void* mapping = image->mapped > 0 ? mmap(NULL, image->mapped, PROT_READ, MAP_SHARED, handle, 0) : MAP_FAILED;
+	if (mapping != MAP_FAILED) image->bytes = static_cast<const uint8_t*>(mapping);
+	close(handle);
+#endif
+	if (image->bytes == NULL) {
+		PrintMessage(Error, "Could not map " + file);
+		return NULL;
+	}
+	if (image->mapped < 0x150) {
+		PrintMessage(Error, file + " is too small to hold a cartridge header");
+		return NULL;
+	}
+	// Header byte 0x148 gives the ROM size as 32 KB << n
+	uint8_t sizeCode = image->bytes[0x0148];
+	if (sizeCode > 8) {
+		PrintMessage(Error, file + " has an unknown ROM size in its header");
+		return NULL;
+	}
+	image->length = static_cast<size_t>(0x8000) << sizeCode;
+	if (image->mapped < image->length) {
+		PrintMessage(Error, file + " is truncated, " + std::to_string(image->mapped) + " of " + std::to_string(image->length) + " bytes");
+		return NULL;
+	}
+	return image;
+}
+
+RomImage::~RomImage() {
+	if (bytes == NULL) return;
+#ifdef _WIN32
+	UnmapViewOfFile(bytes);
+#else
+	munmap(const_cast<uint8_t*>(bytes), mapped);
+#endif
+}
+
+std::shared_ptr<SaveFile> SaveFile::open(const std::string& file, size_t size) {
+	std::shared_ptr<SaveFile> save(new SaveFile());
+	save->length = size;
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(file.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE) {
+		PrintMessage(Error, "Could not open " + file);
+		return NULL;
+	}
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(handle, &fileSize);
+	save->fresh = fileSize.QuadPart == 0;
+	// A mapping larger than the file grows it
+	uint64_t mappingSize = std::max<uint64_t>(fileSize.QuadPart, size);
+	HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READWRITE, static_cast<DWORD>(mappingSize >> 32), static_cast<DWORD>(mappingSize), NULL);
+	if (mapping != NULL) {
+		save->bytes = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size));
+		CloseHandle(mapping);
+	}
+	CloseHandle(handle);
+#else
+	int handle = ::open(file.c_str(), O_RDWR | O_CREAT, 0644);
+	if (handle < 0) {
+		PrintMessage(Error, "Could not open " + file);
+		return NULL;
+	}
+	struct stat info;
+	bool sized = fstat(handle, &info) == 0;
+	save->fresh = sized && info.st_size == 0;
+	// Growing the file reads back zeroes, it is never written here
+	if (sized && static_cast<size_t>(info.st_size) < size) sized = ftruncate(handle, size) == 0;
+	void* mapping = sized ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0) : MAP_FAILED;
+	if (mapping != MAP_FAILED) save->bytes = static_cast<uint8_t*>(mapping);
+	close(handle);
+#endif
+	if (save->bytes == NULL) {
+		PrintMessage(Error, "Could not map " + file);
+		return NULL;
+	}
+	return save;
+}
+
+SaveFile::~SaveFile() {
+	if (bytes == NULL) return;
+	flush();
+#ifdef _WIN32
+	UnmapViewOfFile(bytes);
+#else
+	munmap(bytes, length);
+#endif
+}
+
+void SaveFile::flush() {
+#ifdef _WIN32
+	FlushViewOfFile(bytes, length);
+#else
+	msync(bytes, length, MS_ASYNC);
+#endif
+}
+
+bool NoController::ramMapped(const MMU& mmu) {
+	return mmu.ramEnabled && mmu.ram != NULL;
+}
+
+void NoController::write(MMU& mmu, uint16_t address, uint8_t value) {}
+
+uint8_t NoController::readRam(MMU& mmu, uint16_t address) {
+	// Open bus while RAM is missing or disabled
+	return 0xFF;
+}
+
+void NoController::writeRam(MMU& mmu, uint16_t address, uint8_t value) {}
+
+void MBC1::write(MMU& mmu, uint16_t address, uint8_t value) {
+	switch (address >> 13) {
+	case 0: // RAM enable
+		mmu.enableRam((value & 0x0F) == 0x0A);
+		break;
+	case 1: // Lower 5 bits of the ROM bank, 0 selects 1
+		mmu.bankRegister1 = value & 0x1F;
+		if (mmu.bankRegister1 == 0) mmu.bankRegister1 = 1;
+		break;
+	case 2: // Upper ROM bits or RAM bank
+		mmu.bankRegister2 = value & 0x03;
+		break;
+	case 3:
+		mmu.bankingMode = value & 0x01;
+		break;
+	}
+	mmu.romBank = mmu.bankRegister2 << 5 | mmu.bankRegister1;
+	// Mode 1 applies the upper bits to 0x0000-0x3FFF and RAM as well
+	mmu.lowRomBank = mmu.bankingMode ? mmu.bankRegister2 << 5 : 0;
+	mmu.ramBank = mmu.bankingMode ? mmu.bankRegister2 : 0;
+	mmu.mapBanks();
+}
+
+void MBC2::write(MMU& mmu, uint16_t address, uint8_t value) {
+	if (address >= 0x4000) return;
+	// Address bit 8 selects between RAM enable and the ROM bank
+	if (address & 0x0100) {
+		mmu.romBank = value & 0x0F;
+		if (mmu.romBank == 0) mmu.romBank = 1;
+	}
+	else {
+		mmu.enableRam((value & 0x0F) == 0x0A);
+	}
+	mmu.mapBanks();
+}
+
+void MBC2::writeRam(MMU& mmu, uint16_t address, uint8_t value) {
+	if (!mmu.ramEnabled) return;
+	mmu.ram[address & 0x01FF] = value | 0xF0;
+}
+
+void MBC3::write(MMU& mmu, uint16_t address, uint8_t value) {
+	switch (address >> 13) {
+	case 0: // RAM and clock enable
+		mmu.enableRam((value & 0x0F) == 0x0A);
+		break;
+	case 1:
+		mmu.romBank = value & 0x7F;
+		if (mmu.romBank == 0) mmu.romBank = 1;
+		break;
+	case 2: // RAM bank 00-03 or clock register 08-0C
+		mmu.ramBank = value & 0x0F;
+		break;
+	case 3: // Latching the clock is a no-op while it does not run
+		return;
+	}
+	mmu.mapBanks();
+}
+
+bool MBC3::ramMapped(const MMU& mmu) {
+	return NoController::ramMapped(mmu) && mmu.ramBank < 0x08;
+}
+
+uint8_t MBC3::readRam(MMU& mmu, uint16_t address) {
+	if (mmu.ramEnabled && mmu.ramBank >= 0x08 && mmu.ramBank <= 0x0C) return mmu.clock[mmu.ramBank - 0x08];
+	return 0xFF;
+}
+
+void MBC3::writeRam(MMU& mmu, uint16_t address, uint8_t value) {
+	if (mmu.ramEnabled && mmu.ramBank >= 0x08 && mmu.ramBank <= 0x0C) mmu.clock[mmu.ramBank - 0x08] = value;
+}
+
+void MBC5::write(MMU& mmu, uint16_t address, uint8_t value) {
+	switch (address >> 12) {
+	case 0: case 1: // RAM enable
+		mmu.enableRam((value & 0x0F) == 0x0A);
+		break;
+	case 2: // Lower 8 bits of the ROM bank, bank 0 can be selected
+		mmu.romBank = (mmu.romBank & 0x100) | value;
+		break;
+	case 3: // Bit 8 of the ROM bank
+		mmu.romBank = (mmu.romBank & 0xFF) | (value & 0x01) << 8;
+		break;
+	case 4: case 5:
+		mmu.ramBank = value & 0x0F;
+		break;
+	default:
+		return;
+	}
+	mmu.mapBanks();
+}
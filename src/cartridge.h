@@ -0,0 +1,92 @@
+#pragma once
+#include "definitions.h"
+
+#include <memory>
+
+class MMU;
+
+/*
+	A ROM file mapped read-only and shared (MAP_SHARED / a file mapping view),
+	so every instance running the same ROM uses the one copy in the page
+	cache and banks are only read from disk when first touched. MMUs hold it
+	through a shared_ptr, the JIT's shadow MMU shares its MMU's image.
+*/
+class RomImage {
+public:
+	// Maps file and checks it against the ROM size in its header, NULL on error
+	static std::shared_ptr<RomImage> open(const std::string& file);
+	~RomImage();
+
+	const uint8_t* data() const { return bytes; }
+	// The size declared by the header, always whole 16 KB banks
+	size_t size() const { return length; }
+
+private:
+	RomImage() {}
+	const uint8_t* bytes = NULL;
+	size_t length = 0;
+	size_t mapped = 0; // Size of the file, and so of the mapping
+};
+
+/*
+	Battery backed cartridge RAM kept in a .sav file that is mapped
+	read/write and shared, so the game's writes land in the file's pages
+	directly. flush() only hands the dirty pages to the OS for writeback
+	(MS_ASYNC / FlushViewOfFile) and never writes the file itself.
+*/
+class SaveFile {
+public:
+	// Maps file, creating it or growing it to size bytes, NULL on error
+	static std::shared_ptr<SaveFile> open(const std::string& file, size_t size);
+	~SaveFile();
+
+	uint8_t* data() const { return bytes; }
+	void flush();
+
+	bool fresh = false; // The file did not exist or was empty
+
+private:
+	SaveFile() {}
+	uint8_t* bytes = NULL;
+	size_t length = 0;
+};
+
+/*
+	Memory bank controllers. MMU::attach<Controller>() binds a controller's
+	static handlers for writes to 0x0000-0x7FFF and for external RAM that is
+	not mapped for direct access. Bank switches only change the bank
+	registers in the MMU and call MMU::mapBanks(), which repoints the
+	0x4000-0x7FFF and 0xA000-0xBFFF pages at the selected slice of ROM/RAM.
+	Reads never reach a controller, so a cartridge without one costs nothing.
+	ramMapped() says whether the selected RAM bank can be mapped at all.
+*/
+struct NoController {
+	static const bool directRamWrites = true;
+	static bool ramMapped(const MMU& mmu);
+	static void write(MMU& mmu, uint16_t address, uint8_t value);
+	static uint8_t readRam(MMU& mmu, uint16_t address);
+	static void writeRam(MMU& mmu, uint16_t address, uint8_t value);
+};
+
+struct MBC1 : NoController {
+	static void write(MMU& mmu, uint16_t address, uint8_t value);
+};
+
+// 512 x 4 bits of RAM, so writes keep the upper nibble set
+struct MBC2 : NoController {
+	static const bool directRamWrites = false;
+	static void write(MMU& mmu, uint16_t address, uint8_t value);
+	static void writeRam(MMU& mmu, uint16_t address, uint8_t value);
+};
+
+// RAM banks 08-0C select the clock registers, which are kept but do not run
+struct MBC3 : NoController {
+	static bool ramMapped(const MMU& mmu);
+	static void write(MMU& mmu, uint16_t address, uint8_t value);
+	static uint8_t readRam(MMU& mmu, uint16_t address);
+	static void writeRam(MMU& mmu, uint16_t address, uint8_t value);
+};
+
+struct MBC5 : NoController {
+	static void write(MMU& mmu, uint16_t address, uint8_t value);
+};
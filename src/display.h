@@ -0,0 +1,21 @@
+#pragma once
+#include <SDL.h>
+#include "definitions.h"
+
+/*
+	SDL presenter for the SDL frontend. Owns the window, renderer and
+	streaming texture and copies a finished PPU frame to the screen. Only
+	main.cpp uses it, the emulation core never includes SDL.
+*/
+class Display {
+	public:
+		Display(const char* title);
+		~Display();
+
+		// Shows a frame laid out like PPU::frame()
+		void present(const uint16_t* frame);
+	private:
+		SDL_Window* window;
+		SDL_Renderer* renderer;
+		SDL_Texture* texture;
+};
@@ -0,0 +1,186 @@
+#include "ppu.h"
+#include "mmu.h"
+
+// The thrown away first tile fetch, so a line without scrolling, window or 
+// sprites takes the shortest mode 3 of 172 dots
+const int FIFO_START_DOTS = 7;
+const int SPRITE_FETCH_DOTS = 6;
+
+/*
+	Sets the line up from the registers at mode 3 entry and times it by 
+	stepping a copy of the state to the end without drawing. The line 
+	itself is only drawn as catchUp() and endLine() ask for it.
+*/
+uint64_t FifoRenderer::startLine(PPU& ppu, uint8_t line, uint64_t when) {
+	const uint8_t* memory = ppu.mmu->memory;
+	if (line == 0) ppu.windowLine = 0;
+	ppu.updateTiles();
+	FifoState& state = ppu.fifo;
+	state = FifoState();
+	state.active = true;
+	state.line = line;
+	state.start = when;
+	state.delay = FIFO_START_DOTS;
+	state.discard = memory[0xFF43] & 0x07;
+	state.spriteTotal = ppu.findSprites(line, memory[0xFF40], state.sprites);
+
+	FifoState timing = state;
+	while (timing.x < GB_WIDTH) step(ppu, timing);
+	state.output = ppu.pixelbuffer + line * GB_WIDTH;
+	return (timing.dot + 3) / 4;
+}
+
+// Draws up to the dot the CPU's write to address lands at, before the register changes
+void FifoRenderer::catchUp(PPU& ppu, uint16_t address) {
+	FifoState& state = ppu.fifo;
+	if (!state.active) return;
+	uint64_t now = ppu.mmu->writeTime(address);
+	if (now <= state.start) return;
+	uint64_t dots = (now - state.start) * 4;
+	while (static_cast<uint64_t>(state.dot) < dots && state.x < GB_WIDTH) step(ppu, state);
+}
+
+void FifoRenderer::endLine(PPU& ppu) {
+	FifoState& state = ppu.fifo;
+	if (!state.active) return;
+	while (state.x < GB_WIDTH) step(ppu, state);
+	state.active = false;
+	if (state.windowShown) ppu.windowLine++;
+}
+
+/*
+	One dot. A sprite whose left edge x has reached stalls the pixel output 
+	until the background fetch in progress has its data and the sprite 
+	fetch is done, otherwise the fetcher advances and a pixel is shifted 
+	out when the background FIFO has any.
+*/
+void FifoRenderer::step(PPU& ppu, FifoState& state) {
+	state.dot++;
+	if (state.delay > 0) {
+		state.delay--;
+		return;
+	}
+	if (state.spriteDots > 0) {
+		if (--state.spriteDots == 0) fetchSprite(ppu, state);
+		return;
+	}
+	const uint8_t* memory = ppu.mmu->memory;
+	if (state.nextSprite < state.spriteTotal && (memory[0xFF40] & 0x02) && state.discard == 0) {
+		int left = memory[0xFE00 + state.sprites[state.nextSprite] * 4 + 1] - 8;
+		if (left <= state.x) {
+			if (state.fetchStep < 6) fetch(ppu, state);
+			else state.spriteDots = SPRITE_FETCH_DOTS;
+			return;
+		}
+	}
+	fetch(ppu, state);
+	output(ppu, state);
+}
+
+/*
+	The background fetcher: the tile number is read after 2 dots, its data 
+	is there after 6, and it is pushed as soon as the FIFO is empty. SCX, 
+	SCY and LCDC are read when each step needs them.
+*/
+void FifoRenderer::fetch(PPU& ppu, FifoState& state) {
+	const uint8_t* memory = ppu.mmu->memory;
+	uint8_t lcdc = memory[0xFF40];
+	state.fetchStep++;
+	if (state.fetchStep == 2) {
+		uint16_t address;
+		if (state.window) {
+			address = (lcdc & 0x40 ? 0x9C00 : 0x9800) + (ppu.windowLine >> 3) * 32 + (state.fetchX & 31);
+		}
+		else {
+			uint8_t y = static_cast<uint8_t>(memory[0xFF42] + state.line);
+			address = (lcdc & 0x08 ? 0x9C00 : 0x9800) + (y >> 3) * 32 + (((memory[0xFF43] >> 3) + state.fetchX) & 31);
+		}
+		state.tile = memory[address];
+	}
+	if (state.fetchStep >= 6 && state.backgroundCount == 0) {
+		uint8_t row = state.window ? ppu.windowLine : static_cast<uint8_t>(memory[0xFF42] + state.line);
+		memcpy(state.background, ppu.decodedTiles[ppu.tileIndex(lcdc, state.tile)][row & 7], 8);
+		state.backgroundHead = 0;
+		state.backgroundCount = 8;
+		state.fetchStep = 0;
+		state.fetchX++;
+	}
+}
+
+/*
+	Mixes the sprite's row into the sprite FIFO, slot 0 being pixel x. 
+	Pixels left of x are gone, and slots a sprite fetched earlier already 
+	filled keep their pixel, which is what gives it priority.
+*/
+void FifoRenderer::fetchSprite(PPU& ppu, FifoState& state) {
+	const uint8_t* memory = ppu.mmu->memory;
+	const uint8_t* sprite = memory + 0xFE00 + state.sprites[state.nextSprite++] * 4;
+	int height = memory[0xFF40] & 0x04 ? 16 : 8;
+	uint8_t attributes = sprite[3];
+	int row = state.line - (sprite[0] - 16);
+	if (attributes & 0x40) row = height - 1 - row;
+	int tile = (height == 16 ? sprite[2] & 0xFE : sprite[2]) + (row >> 3);
+	const uint8_t* pattern = (attributes & 0x20 ? ppu.flippedTiles : ppu.decodedTiles)[tile][row & 7];
+	for (int column = 0; column < 8; column++) {
+		int slot = sprite[1] - 8 + column - state.x;
+		if (slot < 0) continue;
+		while (state.spriteCount <= slot) {
+			state.spriteIndices[state.spriteCount] = 0;
+			state.spriteAttributes[state.spriteCount] = 0;
+			state.spriteCount++;
+		}
+		if (state.spriteIndices[slot] == 0) {
+			state.spriteIndices[slot] = pattern[column];
+			state.spriteAttributes[slot] = attributes;
+		}
+	}
+}
+
+/*
+	Shifts out a pixel, or starts the window when x reaches WX - 7. The 
+	palettes and LCDC are read for every pixel, so a write in the middle of 
+	the line takes effect from the pixel it lands on.
+*/
+void FifoRenderer::output(PPU& ppu, FifoState& state) {
+	if (state.backgroundCount == 0) return;
+	const uint8_t* memory = ppu.mmu->memory;
+	uint8_t lcdc = memory[0xFF40];
+	uint8_t wx = memory[0xFF4B];
+	if (!state.window && (lcdc & 0x21) == 0x21 && state.line >= memory[0xFF4A] && state.discard == 0 && state.x + 7 >= wx) {
+		// The FIFO is cleared and the fetcher starts over on the window's first tile
+		state.window = true;
+		state.windowShown = true;
+		state.backgroundCount = 0;
+		state.fetchStep = 0;
+		state.fetchX = 0;
+		if (wx < 7) state.discard = 7 - wx;
+		return;
+	}
+
+	uint8_t index = state.background[state.backgroundHead++];
+	state.backgroundCount--;
+	// LCDC bit 0 blanks the background and the window on the DMG
+	if (!(lcdc & 0x01)) index = 0;
+	if (state.discard > 0) {
+		state.discard--;
+		return;
+	}
+	uint8_t spriteIndex = 0;
+	uint8_t attributes = 0;
+	if (state.spriteCount > 0) {
+		spriteIndex = state.spriteIndices[0];
+		attributes = state.spriteAttributes[0];
+		state.spriteCount--;
+		memmove(state.spriteIndices, state.spriteIndices + 1, state.spriteCount);
+		memmove(state.spriteAttributes, state.spriteAttributes + 1, state.spriteCount);
+	}
+
+	uint8_t palette = memory[0xFF47];
+	// Sprite colour 0 is transparent, behind the background only its colour 0 is drawn over
+	if (spriteIndex != 0 && (lcdc & 0x02) && !((attributes & 0x80) && index != 0)) {
+		palette = memory[attributes & 0x10 ? 0xFF49 : 0xFF48];
+		index = spriteIndex;
+	}
+	if (state.output != NULL) state.output[state.x] = PPU::shades[(palette >> (index * 2)) & 0x03];
+	state.x++;
+}
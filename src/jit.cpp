@@ -0,0 +1,731 @@
+#include "jit.h"
+#include "cpu.h"
+#include "ppu.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_X64
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+// Runs an instruction through its opcodes[] handler. packed = opcode | operand << 8
+static void jitFallback(CPU* cpu, uint32_t packed) {
+	uint8_t inst = packed & 0xFF;
+	cpu->operand = static_cast<uint16_t>(packed >> 8);
+	(cpu->*cpu->opcodes[inst])();
+}
+
+/*
+	Retires an instruction exactly like CPU::execute and tells the native
+	code whether it has to leave the block. packed = opcode | cycles << 8 |
+	address of the next instruction in the block << 16
+*/
+static int jitRetire(CPU* cpu, uint32_t packed) {
+	uint8_t cycles = (packed >> 8) & 0xFF;
+	MMU* mmu = cpu->mmu;
+	if (mmu->interruptsChanged) cpu->handleInterrupts();
+	mmu->scheduler.now += cycles;
+	cpu->cycleBudget -= cycles;
+	if (mmu->scheduler.now >= mmu->scheduler.next) mmu->runEvents();
+	cpu->pc++;
+	cpu->jitBudget--;
+	return cpu->jitBudget == 0 || cpu->cycleBudget <= 0 || cpu->halted || !cpu->jitBlock->valid
+		|| cpu->pc != (packed >> 16);
+}
+
+// Whether the handler only works on the register file: no memory, pc, clock or IME
+static bool registersOnly(const DecodedInstruction& inst) {
+	uint8_t op = inst.opcode;
+	if (op == 0xCB) return (inst.operand & 0x07) != 6;
+	if (op >= 0x40 && op < 0xC0) return op != 0x76 && (op & 0x07) != 6 && (op < 0x70 || op >= 0x78);
+	switch (op) {
+	case 0x04: case 0x05: case 0x0C: case 0x0D: case 0x14: case 0x15: case 0x1C: case 0x1D: // INC/DEC r
+	case 0x24: case 0x25: case 0x2C: case 0x2D: case 0x3C: case 0x3D:
+	case 0x07: case 0x0F: case 0x17: case 0x1F: case 0x27: case 0x2F: case 0x37: case 0x3F: // Rotates A, DAA, CPL, SCF, CCF
+	case 0x09: case 0x19: case 0x29: case 0x39: case 0xE8: case 0xF8: case 0xF9: // 16-bit arithmetic
+	case 0xC6: case 0xCE: case 0xD6: case 0xDE: case 0xE6: case 0xEE: case 0xF6: case 0xFE: // ALU d8
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Settles lazily evaluated flags before native code reads or keeps them
+static int jitEvaluateFlags(CPU* cpu, uint32_t unused) {
+	cpu->evaluateFlags();
+	return 0;
+}
+
+// JP, JR and JR cc set pc themselves when translated
+static bool setsPc(uint8_t opcode) {
+	return opcode == 0xC3 || opcode == 0x18 || (opcode & 0xE7) == 0x20;
+}
+
+// Runs the events that came due with the last instruction of a block
+static int jitRunEvents(CPU* cpu, uint32_t unused) {
+	cpu->mmu->runEvents();
+	return 0;
+}
+
+Jit::Jit(CPU* cpu, bool verify) {
+	this->cpu = cpu;
+	this->verify = verify;
+#ifdef JIT_X64
+	// Never writable and executable at once, compile() flips it, see protect()
+#ifdef _WIN32
+	code = static_cast<uint8_t*>(VirtualAlloc(NULL, JIT_CODE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READ));
+#else
+	void* mapping = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	code = mapping == MAP_FAILED ? NULL : static_cast<uint8_t*>(mapping);
+#endif
+#endif
+	if (code == NULL) {
+		PrintMessage(Info, "JIT unavailable, falling back to the interpreter");
+	}
+	if (verify) {
+		PrintMessage(Info, "JIT verification enabled");
+		shadowMmu = new MMU();
+		shadowMmu->serialOutput = false;
+		if (cpu->mmu->rom != NULL) shadowMmu->insert(cpu->mmu->rom);
+		// Mode 3 lasts as long as the renderer says, so the shadow needs the same one
+		if (cpu->mmu->ppu != NULL) {
+			shadowPpu = new PPU(shadowMmu);
+			shadowPpu->copyRenderer(*cpu->mmu->ppu);
+		}
+		shadow = new CPU(shadowMmu);
+		syncShadow();
+	}
+}
+
+Jit::~Jit() {
+	// Native code is owned by the blocks, make sure none of it outlives us
+	cpu->blockCache->flush();
+#ifdef JIT_X64
+	if (code != NULL) {
+#ifdef _WIN32
+		VirtualFree(code, 0, MEM_RELEASE);
+#else
+		munmap(code, JIT_CODE_SIZE);
+#endif
+	}
+#endif
+	delete shadow;
+	delete shadowPpu;
+	delete shadowMmu;
+}
+
+// Same contract as CPU::run
+uint64_t Jit::run(uint64_t cycles) {
+	cpu->cycleBudget = static_cast<int64_t>(cycles);
+	cpu->stoppedBudget = 0;
+	while (cpu->cycleBudget > 0) {
+		if (cpu->halted) {
+			cpu->execute(1);
+			if (verify) runVerified(NULL);
+			continue;
+		}
+		Block* block = cpu->blockCache->fetch(cpu->pc);
+		if (block->breakpoint && cpu->stopAtBreakpoint()) break;
+		if (block->loopCycles && !verify) {
+			uint64_t instructions = UINT64_MAX;
+			cpu->skipIdleLoop(block, instructions);
+		}
+		if (block->native == NULL && code != NULL && cpu->blockCache->isCached(block)
+			&& (verify || ++block->hits >= JIT_THRESHOLD)) {
+			// A full code buffer flushes the cache, so fetch the block again
+			if (!compile(block)) continue;
+		}
+		if (verify) {
+			runVerified(block);
+		}
+		else if (block->native != NULL) {
+			cpu->jitBlock = block;
+			cpu->jitBudget = UINT64_MAX;
+			block->native(cpu);
+		}
+		else {
+			cpu->execute(block->instructions.size());
+		}
+	}
+	return static_cast<uint64_t>(static_cast<int64_t>(cycles) - cpu->cycleBudget - cpu->stoppedBudget);
+}
+
+uint64_t Jit::runFrame() {
+	return run(CYCLES_PER_FRAME);
+}
+
+// Executes a single instruction and checks it against the shadow interpreter
+void Jit::runVerified(Block* block) {
+	if (block != NULL) {
+		if (block->native != NULL) {
+			cpu->jitBlock = block;
+			cpu->jitBudget = 1;
+			block->native(cpu);
+		}
+		else {
+			cpu->execute(1);
+		}
+	}
+	uint16_t pc = shadow->pc;
+	uint8_t inst = shadowMmu->memory[pc];
+	shadow->interpret(1);
+	if (!compareShadow()) {
+		mismatches++;
+		char message[160];
+		snprintf(message, sizeof(message),
+			"JIT mismatch after PC:%04X OP:%02X (%s) JIT A:%02X F:%02X BC:%02X%02X DE:%02X%02X HL:%02X%02X SP:%04X PC:%04X "
+			"INT A:%02X F:%02X SP:%04X PC:%04X", pc, inst, block != NULL && block->native != NULL ? "native" : "interpreted",
+			cpu->A, cpu->F, cpu->B, cpu->C, cpu->D, cpu->E, cpu->H, cpu->L, cpu->sp, cpu->pc,
+			shadow->A, shadow->F, shadow->sp, shadow->pc);
+		PrintMessage(Error, message);
+		syncShadow();
+	}
+}
+
+void Jit::syncShadow() {
+	memcpy(shadowMmu->memory, cpu->mmu->memory, GB_MEMORY);
+	shadowMmu->interruptsChanged = true;
+	shadowMmu->scheduler = cpu->mmu->scheduler;
+	shadowMmu->divBase = cpu->mmu->divBase;
+	shadowMmu->timerStart = cpu->mmu->timerStart;
+	shadowMmu->timerValue = cpu->mmu->timerValue;
+	shadowMmu->frameSequencerStep = cpu->mmu->frameSequencerStep;
+	shadowMmu->copyCartridgeState(*cpu->mmu);
+	shadowMmu->copyDmaState(*cpu->mmu);
+	shadow->blockCache->flush();
+	RegisterFile state;
+	cpu->saveState(state);
+	shadow->loadState(state);
+}
+
+bool Jit::compareShadow() {
+	cpu->evaluateFlags();
+	shadow->evaluateFlags();
+	return shadow->A == cpu->A && shadow->B == cpu->B && shadow->C == cpu->C && shadow->D == cpu->D
+		&& shadow->E == cpu->E && shadow->F == cpu->F && shadow->H == cpu->H && shadow->L == cpu->L
+		&& shadow->sp == cpu->sp && shadow->pc == cpu->pc && shadow->halted == cpu->halted
+		&& shadow->ime == cpu->ime && shadowMmu->scheduler.now == cpu->mmu->scheduler.now
+		&& shadowMmu->scheduler.next == cpu->mmu->scheduler.next
+		&& memcmp(shadowMmu->memory, cpu->mmu->memory, GB_MEMORY) == 0;
+}
+
+/* CODE EMISSION */
+
+// Maps the pages of the code buffer a block is emitted into read/write
+// while emitting and read/execute otherwise
+bool Jit::protect(uint8_t* start, size_t size, bool writable) {
+#ifdef JIT_X64
+	size_t first = (start - code) & ~(JIT_PAGE_SIZE - 1);
+	size_t length = std::min(((start - code) + size + JIT_PAGE_SIZE - 1) & ~(JIT_PAGE_SIZE - 1), JIT_CODE_SIZE) - first;
+#ifdef _WIN32
+	DWORD previous;
+	if (!VirtualProtect(code + first, length, writable ? PAGE_READWRITE : PAGE_EXECUTE_READ, &previous)) return false;
+	if (!writable) FlushInstructionCache(GetCurrentProcess(), code + first, length);
+	return true;
+#else
+	return mprotect(code + first, length, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) == 0;
+#endif
+#else
+	return false;
+#endif
+}
+
+void Jit::emit8(uint8_t value) {
+	*emitPtr++ = value;
+}
+
+void Jit::emit16(uint16_t value) {
+	memcpy(emitPtr, &value, 2);
+	emitPtr += 2;
+}
+
+void Jit::emit32(uint32_t value) {
+	memcpy(emitPtr, &value, 4);
+	emitPtr += 4;
+}
+
+void Jit::emit64(uint64_t value) {
+	memcpy(emitPtr, &value, 8);
+	emitPtr += 8;
+}
+
+int32_t Jit::offsetOf(void* field) {
+	return static_cast<int32_t>(reinterpret_cast<uint8_t*>(field) - reinterpret_cast<uint8_t*>(cpu));
+}
+
+// Opcode followed by a [rbx + disp32] operand, rbx holding the CPU pointer
+void Jit::emitField(uint8_t opcode, uint8_t modrm, void* field) {
+	emit8(opcode);
+	emit8(0x83 | modrm << 3);
+	emit32(offsetOf(field));
+}
+
+// mov rax, [rbx + mmu], for the emitMmuField operands that follow
+void Jit::emitLoadMmu() {
+	emit8(0x48);
+	emitField(0x8B, 0, &cpu->mmu);
+}
+
+// Opcode followed by a [rax + disp32] operand
+void Jit::emitIndirect(uint8_t opcode, uint8_t modrm, int32_t displacement) {
+	emit8(opcode);
+	emit8(0x80 | modrm << 3);
+	emit32(displacement);
+}
+
+// Opcode followed by a [rax + disp32] operand, rax holding the MMU pointer
+void Jit::emitMmuField(uint8_t opcode, uint8_t modrm, void* field) {
+	emitIndirect(opcode, modrm, static_cast<int32_t>(reinterpret_cast<uint8_t*>(field) - reinterpret_cast<uint8_t*>(cpu->mmu)));
+}
+
+// jcc rel32 (or jmp for condition 0), returns the displacement to patch
+uint8_t* Jit::emitJump(uint8_t condition) {
+	if (condition == 0) {
+		emit8(0xE9);
+	}
+	else {
+		emit8(0x0F);
+		emit8(condition);
+	}
+	emit32(0);
+	return emitPtr - 4;
+}
+
+void Jit::patchJump(uint8_t* jump, uint8_t* target) {
+	int32_t rel = static_cast<int32_t>(target - (jump + 4));
+	memcpy(jump, &rel, 4);
+}
+
+// Looks up the page of the address in ecx, leaving the page pointer in rax
+// and the offset in ecx. NULL pages jump to the displacement added to slow
+void Jit::emitPageLookup(bool write, std::vector<uint8_t*>& slow) {
+	uint8_t** table = write ? cpu->mmu->writePages : cpu->mmu->readPages;
+	emit8(0x89); emit8(0xCA);                                  // mov edx, ecx
+	emit8(0xC1); emit8(0xEA); emit8(0x08);                     // shr edx, 8
+	emitLoadMmu();
+	emit8(0x48); emit8(0x8B); emit8(0x84); emit8(0xD0);        // mov rax, [rax + rdx * 8 + table]
+	emit32(static_cast<int32_t>(reinterpret_cast<uint8_t*>(table) - reinterpret_cast<uint8_t*>(cpu->mmu)));
+	emit8(0x48); emit8(0x85); emit8(0xC0);                     // test rax, rax
+	slow.push_back(emitJump(0x84));                            // jz
+	emit8(0x0F); emit8(0xB6); emit8(0xC9);                     // movzx ecx, cl
+}
+
+// Checks that nothing is due within the next cycles, jumps to the returned
+// displacement otherwise: interruptsChanged set or now + cycles >= next
+void Jit::emitDueCheck(uint32_t cycles, std::vector<uint8_t*>& jumps) {
+	emitLoadMmu();
+	emitMmuField(0x80, 7, &cpu->mmu->interruptsChanged);      // cmp byte [interruptsChanged], 0
+	emit8(0x00);
+	jumps.push_back(emitJump(0x85));                           // jne
+	emit8(0x48); emitMmuField(0x8B, 1, &cpu->mmu->scheduler.now); // mov rcx, [now]
+	emit8(0x48); emit8(0x81); emit8(0xC1); emit32(cycles);     // add rcx, cycles
+	emit8(0x48); emitMmuField(0x3B, 1, &cpu->mmu->scheduler.next); // cmp rcx, [next]
+	jumps.push_back(emitJump(0x83));                           // jae
+}
+
+void Jit::emitEvaluateFlags() {
+	emitField(0x80, 7, &cpu->flagOp);                          // cmp byte [flagOp], FLAGS_NONE
+	emit8(FLAGS_NONE);
+	uint8_t* settled = emitJump(0x84);                         // je
+	emitCall(reinterpret_cast<void*>(&jitEvaluateFlags), 0);
+	patchJump(settled, emitPtr);
+}
+
+// Retires cycles on the clock and the budget at once, negative to take them back
+void Jit::emitCycles(int32_t cycles) {
+	if (cycles == 0) return;
+	emitLoadMmu();
+	emit8(0x48); emitMmuField(0x81, 0, &cpu->mmu->scheduler.now); // add qword [now], cycles
+	emit32(cycles);
+	emit8(0x48); emitField(0x81, 5, &cpu->cycleBudget);           // sub qword [cycleBudget], cycles
+	emit32(cycles);
+}
+
+/*
+	Runs an instruction that may look at pc or the clock, or change what
+	the fast path checked on entry, then checks that again: jumps to the
+	displacements added to bails if an interrupt may be due, an event is
+	due within the next cycles or the handler invalidated the block.
+*/
+void Jit::emitHandler(const DecodedInstruction& inst, uint32_t cycles, int32_t validOffset,
+	std::vector<uint8_t*>& bails, bool native) {
+	emit8(0x66);
+	emitField(0xC7, 0, &cpu->pc);
+	emit16(inst.address);
+	if (native) translate(inst);
+	else emitCall(reinterpret_cast<void*>(&jitFallback), inst.opcode | inst.operand << 8);
+	emitDueCheck(cycles, bails);
+	emit8(0x48); emitField(0x8B, 0, &cpu->jitBlock);      // mov rax, [jitBlock]
+	emitIndirect(0x80, 7, validOffset);                  // cmp byte [valid], 0
+	emit8(0x00);
+	bails.push_back(emitJump(0x84));                     // je
+}
+
+// call function(cpu, argument), result in eax
+void Jit::emitCall(void* function, uint32_t argument) {
+#ifdef _WIN32
+	emit8(0x48); emit8(0x89); emit8(0xD9); // mov rcx, rbx
+	emit8(0xBA); emit32(argument);         // mov edx, imm32
+#else
+	emit8(0x48); emit8(0x89); emit8(0xDF); // mov rdi, rbx
+	emit8(0xBE); emit32(argument);         // mov esi, imm32
+#endif
+	emit8(0x48); emit8(0xB8); emit64(reinterpret_cast<uint64_t>(function)); // mov rax, imm64
+	emit8(0xFF); emit8(0xD0);              // call rax
+}
+
+/*
+	A block gets two versions. The fast path runs when the block cannot see
+	an event, an interrupt or the end of the budget before its last
+	instruction: it checks that once on entry, keeps the clock in step only
+	where a handler may look at it and retires everything at the end. After
+	each handler it checks again, and if the handler changed any of that
+	(IF/IE written, an event moved up, the block overwritten) it retires the
+	instruction through jitRetire() and leaves. Otherwise the slow path
+	retires every instruction through jitRetire().
+*/
+bool Jit::compile(Block* block) {
+	size_t count = block->instructions.size();
+	size_t reserve = 64 + count * 512;
+	if (used + reserve > JIT_CODE_SIZE) {
+		PrintMessage(Info, "JIT code buffer full, flushing");
+		cpu->blockCache->flush();
+		used = 0;
+		return false;
+	}
+	if (!protect(code + used, reserve, true)) return false;
+	emitPtr = code + used;
+	uint8_t* start = emitPtr;
+	std::vector<uint8_t*> exits;
+	std::vector<uint8_t*> slow;
+	int32_t validOffset = static_cast<int32_t>(reinterpret_cast<uint8_t*>(&block->valid) - reinterpret_cast<uint8_t*>(block));
+
+	emit8(0x53);                                         // push rbx
+#ifdef _WIN32
+	emit8(0x48); emit8(0x83); emit8(0xEC); emit8(0x20); // sub rsp, 32 (shadow space)
+	emit8(0x48); emit8(0x89); emit8(0xCB);              // mov rbx, rcx
+#else
+	emit8(0x48); emit8(0x89); emit8(0xFB);              // mov rbx, rdi
+#endif
+	uint32_t total = 0;
+	for (const DecodedInstruction& inst : block->instructions) total += inst.cycles;
+	uint32_t beforeLast = total - block->instructions.back().cycles;
+	emitDueCheck(beforeLast, slow);
+	emit8(0x48); emitField(0x81, 7, &cpu->cycleBudget);  // cmp qword [cycleBudget], beforeLast
+	emit32(beforeLast);
+	slow.push_back(emitJump(0x8E));                     // jle
+	emit8(0x48); emitField(0x81, 7, &cpu->jitBudget);    // cmp qword [jitBudget], count
+	emit32(static_cast<uint32_t>(count));
+	slow.push_back(emitJump(0x82));                     // jb
+
+	// Fast path
+	std::vector<std::vector<uint8_t*>> bails(count);
+	std::vector<HandlerStub> stubs;
+	bool synced = false;
+	uint32_t elapsed = 0;
+	uint32_t pending = 0;
+	for (size_t i = 0; i < count; i++) {
+		const DecodedInstruction& inst = block->instructions[i];
+		uint8_t* body = emitPtr;
+		HandlerStub stub = { i, {}, pending, elapsed, NULL };
+		bool native = translate(inst, &stub.jumps);
+		synced = false;
+		// EI and the handlers may change what the entry check saw, and
+		// the handlers may read the clock and pc, so those are brought up
+		// to date first and the instruction is emitted again after them.
+		// Handlers that only work on registers can do neither
+		if (!native && registersOnly(inst)) {
+			emitCall(reinterpret_cast<void*>(&jitFallback), inst.opcode | inst.operand << 8);
+		}
+		else if (!native || inst.opcode == 0xFB) {
+			emitPtr = body;
+			synced = true;
+			emitCycles(pending);
+			emitHandler(inst, beforeLast - elapsed, validOffset, bails[i], native);
+			pending = 0;
+		}
+		else if (!stub.jumps.empty()) {
+			stub.resume = emitPtr;
+			stubs.push_back(stub);
+		}
+		pending += inst.cycles;
+		elapsed += inst.cycles;
+	}
+	const DecodedInstruction& last = block->instructions.back();
+	if (synced || setsPc(last.opcode)) {
+		// JP/JR and the handlers leave pc one short of the next instruction
+		emit8(0x66);
+		emitField(0xFF, 0, &cpu->pc);                    // inc word [pc]
+	}
+	else {
+		emit8(0x66);
+		emitField(0xC7, 0, &cpu->pc);
+		emit16(last.address + last.length);
+	}
+	emitCycles(pending);
+	emit8(0x48); emitField(0x81, 5, &cpu->jitBudget);    // sub qword [jitBudget], count
+	emit32(static_cast<uint32_t>(count));
+	emitLoadMmu();
+	emit8(0x48); emitMmuField(0x8B, 1, &cpu->mmu->scheduler.now); // mov rcx, [now]
+	emit8(0x48); emitMmuField(0x3B, 1, &cpu->mmu->scheduler.next); // cmp rcx, [next]
+	uint8_t* noEvents = emitJump(0x82);                 // jb
+	emitCall(reinterpret_cast<void*>(&jitRunEvents), 0);
+	patchJump(noEvents, emitPtr);
+	exits.push_back(emitJump(0));
+
+	// Accesses the page tables cannot do run the handler, with the clock
+	// brought up to date around it
+	for (HandlerStub& stub : stubs) {
+		for (uint8_t* jump : stub.jumps) patchJump(jump, emitPtr);
+		emitCycles(stub.pending);
+		emitHandler(block->instructions[stub.index], beforeLast - stub.elapsed, validOffset, bails[stub.index], false);
+		emitCycles(-static_cast<int32_t>(stub.pending));
+		patchJump(emitJump(0), stub.resume);
+	}
+
+	// Leaving the fast path after instruction i, which has not retired yet
+	elapsed = 0;
+	for (size_t i = 0; i < count; i++) {
+		const DecodedInstruction& inst = block->instructions[i];
+		if (!bails[i].empty()) {
+			for (uint8_t* jump : bails[i]) patchJump(jump, emitPtr);
+			emit8(0x48); emitField(0x81, 5, &cpu->jitBudget);
+			emit32(static_cast<uint32_t>(i));
+			uint16_t next = inst.address + inst.length;
+			emitCall(reinterpret_cast<void*>(&jitRetire), inst.opcode | inst.cycles << 8 | next << 16);
+			exits.push_back(emitJump(0));
+		}
+	}
+
+	// Slow path
+	for (uint8_t* jump : slow) patchJump(jump, emitPtr);
+	stubs.clear();
+	for (size_t i = 0; i < count; i++) {
+		const DecodedInstruction& inst = block->instructions[i];
+		HandlerStub stub = { i, {}, 0, 0, NULL };
+		if (!translate(inst, &stub.jumps)) {
+			emitCall(reinterpret_cast<void*>(&jitFallback), inst.opcode | inst.operand << 8);
+		}
+		else {
+			if (!stub.jumps.empty()) {
+				stub.resume = emitPtr;
+				stubs.push_back(stub);
+			}
+			if (inst.length > 1 && !setsPc(inst.opcode)) {
+				emit8(0x66);
+				emitField(0xC7, 0, &cpu->pc);
+				emit16(inst.address + inst.length - 1);
+			}
+		}
+		uint16_t next = inst.address + inst.length;
+		emitCall(reinterpret_cast<void*>(&jitRetire), inst.opcode | inst.cycles << 8 | next << 16);
+		if (i + 1 < count) {
+			emit8(0x85); emit8(0xC0);                   // test eax, eax
+			exits.push_back(emitJump(0x85));            // jnz exit
+		}
+	}
+	exits.push_back(emitJump(0));
+	for (HandlerStub& stub : stubs) {
+		for (uint8_t* jump : stub.jumps) patchJump(jump, emitPtr);
+		emitCall(reinterpret_cast<void*>(&jitFallback), block->instructions[stub.index].opcode | block->instructions[stub.index].operand << 8);
+		patchJump(emitJump(0), stub.resume);
+	}
+	for (uint8_t* exit : exits) patchJump(exit, emitPtr);
+#ifdef _WIN32
+	emit8(0x48); emit8(0x83); emit8(0xC4); emit8(0x20); // add rsp, 32
+#endif
+	emit8(0x5B);                                         // pop rbx
+	emit8(0xC3);                                         // ret
+
+	used += emitPtr - start;
+	block->native = reinterpret_cast<NativeBlock>(start);
+	return protect(start, reserve, false);
+}
+
+/*
+	Emits native code for the instructions that only touch the register file
+	and, when slow is given, for loads and stores through the MMU's page
+	tables. Those test the page pointer and jump to the displacements added
+	to slow when an access needs MMU::read/write, where compile() runs the
+	handler instead. Only JP and JR write pc, leaving it on the last byte of
+	the instruction like the handlers do (the retire step adds one);
+	compile() keeps pc for the rest.
+*/
+bool Jit::translate(const DecodedInstruction& inst, std::vector<uint8_t*>* slow) {
+	uint8_t* registers[8] = { &cpu->B, &cpu->C, &cpu->D, &cpu->E, &cpu->H, &cpu->L, NULL, &cpu->A };
+	uint16_t* pairs[4] = { &cpu->BC, &cpu->DE, &cpu->HL, &cpu->sp };
+	uint8_t* pairHigh[3] = { &cpu->B, &cpu->D, &cpu->H };
+	uint8_t* pairLow[3] = { &cpu->C, &cpu->E, &cpu->L };
+	uint8_t op = inst.opcode;
+
+	if (op == 0x00) {
+		// NOP
+	}
+	else if (op >= 0x40 && op < 0x80 && op != 0x76 && (op & 0x07) != 6 && ((op >> 3) & 0x07) != 6) {
+		// LD r,r'
+		emitField(0x8A, 0, registers[op & 0x07]);       // mov al, [src]
+		emitField(0x88, 0, registers[(op >> 3) & 0x07]); // mov [dst], al
+	}
+	else if ((op & 0xC7) == 0x06 && op != 0x36) {
+		// LD r,d8
+		emitField(0xC6, 0, registers[(op >> 3) & 0x07]);
+		emit8(static_cast<uint8_t>(inst.operand));
+	}
+	else if ((op & 0xCF) == 0x01) {
+		// LD rr,d16 / LD SP,d16
+		emit8(0x66);
+		emitField(0xC7, 0, pairs[op >> 4]);              // mov word [rr], d16
+		emit16(inst.operand);
+	}
+	else if ((op & 0xC7) == 0x03) {
+		// INC rr / DEC rr / INC SP / DEC SP
+		emit8(0x66);
+		emitField(0xFF, op & 0x08 ? 1 : 0, pairs[op >> 4]); // inc/dec word [rr]
+	}
+	else if (op == 0xAF) {
+		// XOR A: A = 0, flags recorded lazily like CPU::XOR
+		emitField(0xC6, 0, &cpu->A);
+		emit8(0x00);
+		emit8(0x66);
+		emitField(0xC7, 0, &cpu->flagResult);            // mov word [flagResult], 0
+		emit16(0x0000);
+		emitField(0xC6, 0, &cpu->flagOp);                // mov byte [flagOp], FLAGS_OR
+		emit8(FLAGS_OR);
+	}
+	else if ((op >= 0x80 && op < 0xC0 && (op & 0x07) != 6) || (op & 0xC7) == 0xC6) {
+		// ADD/SUB/AND/XOR/OR/CP with r or d8, flags recorded lazily like the
+		// CPU's ALU functions. ADC and SBC need the carry, so stay handlers
+		uint8_t operation = (op >> 3) & 0x07;
+		if (operation == 1 || operation == 3) return false;
+		emit8(0x0F); emitField(0xB6, 0, &cpu->A);        // movzx eax, byte [A]
+		if (op < 0xC0) {
+			emit8(0x0F); emitField(0xB6, 1, registers[op & 0x07]); // movzx ecx, byte [r]
+		}
+		else {
+			emit8(0xB9); emit32(inst.operand & 0xFF);    // mov ecx, d8
+		}
+		if (operation == 0 || operation == 2 || operation == 7) {
+			emitField(0x88, 0, &cpu->flagOperand1);      // mov [flagOperand1], al
+			emitField(0x88, 1, &cpu->flagOperand2);      // mov [flagOperand2], cl
+		}
+		static const uint8_t instructions[8] = { 0x01, 0, 0x29, 0, 0x21, 0x31, 0x09, 0x29 }; // add/sub/and/xor/or
+		static const uint8_t flagOps[8] = { FLAGS_ADD, 0, FLAGS_SUB, 0, FLAGS_AND, FLAGS_OR, FLAGS_OR, FLAGS_SUB };
+		emit8(instructions[operation]); emit8(0xC8);     // op eax, ecx
+		emit8(0x66); emitField(0x89, 0, &cpu->flagResult); // mov [flagResult], ax
+		emitField(0xC6, 0, &cpu->flagOp);
+		emit8(flagOps[operation]);
+		if (operation != 7) emitField(0x88, 0, &cpu->A); // mov [A], al, CP only compares
+	}
+	else if (slow != NULL && ((op >= 0x40 && op < 0x80 && op != 0x76 && ((op & 0x07) == 6 || (op & 0xF8) == 0x70))
+		|| (op & 0xC7) == 0x02)) {
+		// LD r,(HL) / LD (HL),r / LD A,(BC/DE/HL+/HL-) / LD (BC/DE/HL+/HL-),A
+		bool store = op < 0x40 ? !(op & 0x08) : (op & 0xF8) == 0x70;
+		uint16_t* address = op < 0x20 ? pairs[op >> 4] : &cpu->HL;
+		uint8_t* value = op < 0x40 ? &cpu->A : registers[store ? op & 0x07 : (op >> 3) & 0x07];
+		emit8(0x0F); emitField(0xB7, 1, address);        // movzx ecx, word [rr]
+		emitPageLookup(store, *slow);
+		if (store) {
+			emitField(0x8A, 2, value);                   // mov dl, [r]
+			emit8(0x88); emit8(0x14); emit8(0x08);       // mov [rax + rcx], dl
+		}
+		else {
+			emit8(0x8A); emit8(0x04); emit8(0x08);       // mov al, [rax + rcx]
+			emitField(0x88, 0, value);                   // mov [r], al
+		}
+		if (op == 0x22 || op == 0x2A || op == 0x32 || op == 0x3A) {
+			emit8(0x66);
+			emitField(0xFF, op >= 0x30 ? 1 : 0, &cpu->HL); // inc/dec word [HL]
+		}
+	}
+	else if (slow != NULL && (op == 0xC1 || op == 0xD1 || op == 0xE1)) {
+		// POP BC/DE/HL, low byte from sp and high byte from sp + 1
+		for (int i = 0; i < 2; i++) {
+			emit8(0x0F); emitField(0xB7, 1, &cpu->sp);   // movzx ecx, word [sp]
+			if (i == 1) {
+				emit8(0xFF); emit8(0xC1);                // inc ecx
+				emit8(0x0F); emit8(0xB7); emit8(0xC9);   // movzx ecx, cx
+			}
+			emitPageLookup(false, *slow);
+			emit8(0x8A); emit8(0x04); emit8(0x08);       // mov al, [rax + rcx]
+			emitField(0x88, 0, i == 0 ? pairLow[(op >> 4) & 0x03] : pairHigh[(op >> 4) & 0x03]);
+		}
+		emit8(0x66);
+		emitField(0x83, 0, &cpu->sp);                    // add word [sp], 2
+		emit8(0x02);
+	}
+	else if (slow != NULL && (op == 0xC5 || op == 0xD5 || op == 0xE5)) {
+		// PUSH BC/DE/HL, high byte to sp - 1 and low byte to sp - 2
+		for (int i = 1; i <= 2; i++) {
+			emit8(0x0F); emitField(0xB7, 1, &cpu->sp);   // movzx ecx, word [sp]
+			emit8(0x83); emit8(0xE9); emit8(i);          // sub ecx, i
+			emit8(0x0F); emit8(0xB7); emit8(0xC9);       // movzx ecx, cx
+			emitPageLookup(true, *slow);
+			emitField(0x8A, 2, i == 1 ? pairHigh[(op >> 4) & 0x03] : pairLow[(op >> 4) & 0x03]); // mov dl, [r]
+			emit8(0x88); emit8(0x14); emit8(0x08);       // mov [rax + rcx], dl
+		}
+		emit8(0x66);
+		emitField(0x83, 5, &cpu->sp);                    // sub word [sp], 2
+		emit8(0x02);
+	}
+	else if ((op & 0xC6) == 0x04 && op != 0x34 && op != 0x35) {
+		// INC r / DEC r, which keep C and so settle pending flags first
+		uint8_t* reg = registers[(op >> 3) & 0x07];
+		emitEvaluateFlags();
+		emitField(0xFE, op & 0x01, reg);                // inc/dec byte [r]
+		emit8(0x0F); emitField(0xB6, 0, reg);            // movzx eax, byte [r]
+		emit8(0x66); emitField(0x89, 0, &cpu->flagResult); // mov [flagResult], ax
+		emitField(0xC6, 0, &cpu->flagOp);
+		emit8(op & 0x01 ? FLAGS_DEC : FLAGS_INC);
+	}
+	else if ((op & 0xE7) == 0x20) {
+		// JR cc
+		static const uint8_t masks[4] = { 0x80, 0x80, 0x10, 0x10 };
+		uint8_t cc = (op >> 3) & 0x03;
+		emitEvaluateFlags();
+		emitField(0xF6, 0, &cpu->F);                     // test byte [F], mask
+		emit8(masks[cc]);
+		uint8_t* notTaken = emitJump(cc & 0x01 ? 0x84 : 0x85); // jz/jnz
+		emit8(0x66);
+		emitField(0xC7, 0, &cpu->pc);
+		emit16(static_cast<uint16_t>(inst.address + 1 + static_cast<int8_t>(inst.operand)));
+		uint8_t* done = emitJump(0);
+		patchJump(notTaken, emitPtr);
+		emit8(0x66);
+		emitField(0xC7, 0, &cpu->pc);
+		emit16(inst.address + 1);
+		patchJump(done, emitPtr);
+	}
+	else if (op == 0xF3) {
+		// DI
+		emitField(0xC6, 0, &cpu->ime);
+		emit8(0);
+	}
+	else if (op == 0xFB) {
+		// EI, which like CPU::EI has the next retire look for pending interrupts
+		emitField(0xC6, 0, &cpu->ime);
+		emit8(1);
+		emitLoadMmu();
+		emitMmuField(0xC6, 0, &cpu->mmu->interruptsChanged);
+		emit8(1);
+	}
+	else if (op == 0xC3) {
+		// JP a16
+		emit8(0x66);
+		emitField(0xC7, 0, &cpu->pc);
+		emit16(inst.operand - 1);
+	}
+	else if (op == 0x18) {
+		// JR e
+		emit8(0x66);
+		emitField(0xC7, 0, &cpu->pc);
+		emit16(static_cast<uint16_t>(inst.address + 1 + static_cast<int8_t>(inst.operand)));
+	}
+	else {
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "definitions.h"
+#include "blockcache.h"
+
+class CPU;
+class PPU;
+
+const int JIT_THRESHOLD = 32;
+const size_t JIT_CODE_SIZE = 4 * 1024 * 1024;
+// Granularity of the code buffer's protection
+const size_t JIT_PAGE_SIZE = 4096;
+
+/*
+	Optional x86-64 translator for hot blocks of the block cache. Register
+	moves, 8-bit ALU operations, INC/DEC, 16-bit increments, immediate
+	loads, PUSH/POP, direct and conditional relative jumps, and loads and
+	stores through the MMU page tables are emitted as native code; every
+	other instruction calls the existing opcodes[] handler, as does any
+	access to a page without a direct pointer, so IO side effects stay
+	exact. When no event can come due inside the block and the budget
+	covers all of it, the block runs on a fast path that puts its cycles on
+	the clock once at the end; otherwise it retires each instruction the
+	same way the interpreter does and leaves on a taken branch, an
+	interrupt, HALT, an exhausted cycle budget or a write into the block
+	itself. The code buffer is only writable while a block is compiled.
+
+	With verify set, every translated instruction is run one at a time and
+	compared against a shadow CPU/MMU pair stepped by the interpreter.
+*/
+class Jit {
+public:
+	Jit(CPU* cpu, bool verify = false);
+	~Jit();
+
+	uint64_t run(uint64_t cycles);
+	uint64_t runFrame();
+
+	bool verify;
+	uint64_t mismatches = 0;
+
+private:
+	CPU* cpu;
+	CPU* shadow = NULL;
+	MMU* shadowMmu = NULL;
+	PPU* shadowPpu = NULL;
+
+	// A memory access of the fast path that has to run the handler
+	struct HandlerStub {
+		size_t index;                // Of the instruction in the block
+		std::vector<uint8_t*> jumps; // Taken when a page has no direct pointer
+		uint32_t pending;            // Cycles not yet on the clock before it
+		uint32_t elapsed;            // Cycles of the instructions before it
+		uint8_t* resume;             // Code after the instruction
+	};
+
+	uint8_t* code = NULL;
+	size_t used = 0;
+	uint8_t* emitPtr;
+
+	bool protect(uint8_t* start, size_t size, bool writable);
+	bool compile(Block* block);
+	bool translate(const DecodedInstruction& inst, std::vector<uint8_t*>* slow = NULL);
+	void runVerified(Block* block);
+	void syncShadow();
+	bool compareShadow();
+
+	void emit8(uint8_t value);
+	void emit16(uint16_t value);
+	void emit32(uint32_t value);
+	void emit64(uint64_t value);
+	void emitField(uint8_t opcode, uint8_t modrm, void* field);
+	void emitLoadMmu();
+	void emitIndirect(uint8_t opcode, uint8_t modrm, int32_t displacement);
+	void emitMmuField(uint8_t opcode, uint8_t modrm, void* field);
+	uint8_t* emitJump(uint8_t condition);
+	void patchJump(uint8_t* jump, uint8_t* target);
+	void emitPageLookup(bool write, std::vector<uint8_t*>& slow);
+	void emitDueCheck(uint32_t cycles, std::vector<uint8_t*>& jumps);
+	void emitEvaluateFlags();
+	void emitCycles(int32_t cycles);
+	void emitHandler(const DecodedInstruction& inst, uint32_t cycles, int32_t validOffset,
+		std::vector<uint8_t*>& bails, bool native);
+	void emitCall(void* function, uint32_t argument);
+	int32_t offsetOf(void* field);
+};
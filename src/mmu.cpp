@@ -1,48 +1,691 @@
 #include "mmu.h"
+#include "blockcache.h"
+#include "cpu.h"
+#include "ppu.h"
+
+#include <iterator>
+
+// M-cycles per TIMA increment for each TAC clock select
+static const uint64_t timerPeriods[4] = { 256, 4, 16, 64 };
+const uint64_t DIV_PERIOD = 64;
+const uint64_t SERIAL_TRANSFER_CYCLES = 8 * 128;
+const uint64_t FRAME_SEQUENCER_PERIOD = 2048;
+const uint64_t DMA_CYCLES = 160;
+// Length of STAT mode 2 (OAM search). The PPU's renderer decides how long
+// mode 3 (pixel transfer) takes and mode 0 fills the rest of the line
+const uint64_t MODE2_CYCLES = 20;
+
+// The page mirrored by echo RAM (E000-FDFF shows C000-DDFF), or page itself
+static uint8_t echoPage(uint8_t page) {
+	if (page >= 0xC0 && page < 0xDE) return page + 0x20;
+	if (page >= 0xE0 && page < 0xFE) return page - 0x20;
+	return page;
+}
 
 MMU::MMU() {
 	PrintMessage(Info, "Instantiating memory array");
 	memset(memory, 0, GB_MEMORY);
+	memset(codePages, 0, sizeof(codePages));
+	memset(pageFlags, 0, sizeof(pageFlags));
+	dirtyTiles.set();
+	dirtyMapEntries.set();
+	dirtySprites.set();
+	for (int page = 0; page < 0x100; page++) {
+		pages[page] = memory + ((page >= 0xE0 && page < 0xFE ? page - 0x20 : page) << 8);
+		updateReadPage(page);
+		updateWritePage(page);
+	}
+	// Until a cartridge is inserted ROM reads from memory and external RAM is unmapped
+	mapBanks();
+	scheduler.schedule(EVENT_FRAME_SEQUENCER, FRAME_SEQUENCER_PERIOD);
 }
 
 MMU::~MMU() {}
 
-void MMU::load(std::string file) {
+// The .sav next to a ROM, replacing its extension if it has one
+static std::string savePath(const std::string& file) {
+    size_t dot = file.find_last_of('.');
+    size_t slash = file.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return file + ".sav";
+    return file.substr(0, dot) + ".sav";
+}
+
+bool MMU::load(std::string file) {
 	PrintMessage(Info, "Loading cartridge"); 
-    std::ifstream rom(file, std::ios::binary);
-    rom.seekg(0, std::ios::end);
-    auto size = rom.tellg();
-    rom.seekg(std::ios::beg);
-    rom.read((char *)memory, size);
-    rom.close();
-    for (int i = 0x0134; i < 0x0143; i++) title.push_back(memory[i]);
-}
-
-void MMU::set(uint16_t address, uint8_t value) {
-    switch (address) { 
-    case 0xFF01: 
-        std::cout << value;
+    std::shared_ptr<RomImage> image = RomImage::open(file);
+    if (image == NULL) return false;
+    insert(image);
+    if (battery && ramSize > 0) loadSave(savePath(file));
+    return true;
+}
+
+// External RAM sizes by header byte 0x149
+static const uint32_t ramSizes[6] = { 0, 0x800, 0x2000, 0x8000, 0x20000, 0x10000 };
+
+void MMU::insert(std::shared_ptr<RomImage> image) {
+    rom = std::move(image);
+    const uint8_t* header = rom->data();
+    title.clear();
+    for (int i = 0x0134; i < 0x0143; i++) title.push_back(header[i]);
+    uint8_t type = header[0x0147];
+    ramBuffer.assign(header[0x0149] < 6 ? ramSizes[header[0x0149]] : 0, 0);
+    save = NULL;
+    switch (type) {
+    case 0x00: case 0x08: case 0x09:
+        attach<NoController>();
+        // Plain RAM on a cartridge without a controller is always enabled
+        ramEnabled = true;
+        break;
+    case 0x01: case 0x02: case 0x03:
+        attach<MBC1>();
         break;
-    case 0xFF0F: // IF
-        interruptFlags.reset() ^= value;
+    case 0x05: case 0x06:
+        ramBuffer.assign(0x200, 0xFF);
+        attach<MBC2>();
         break;
-    case 0xFFFF: // IE
-        interruptEnable.reset() ^= value;
+    case 0x0F: case 0x10: case 0x11: case 0x12: case 0x13:
+        attach<MBC3>();
         break;
-    case 0xFF04: // DIV
-        memory[address] = 0x00;
-    case 0xFF07: // TIMER CONTROL
-        TAC.reset() ^= value;
+    case 0x19: case 0x1A: case 0x1B: case 0x1C: case 0x1D: case 0x1E:
+        attach<MBC5>();
         break;
     default:
+        PrintMessage(Error, "Unsupported cartridge type, running without a bank controller");
+        attach<NoController>();
         break;
     }
+    ram = ramBuffer.empty() ? NULL : ramBuffer.data();
+    ramSize = ramBuffer.size();
+    battery = type == 0x03 || type == 0x06 || type == 0x09 || type == 0x0F || type == 0x10 ||
+        type == 0x13 || type == 0x1B || type == 0x1E;
+    mapBanks();
+}
+
+bool MMU::loadSave(std::string file) {
+    std::shared_ptr<SaveFile> mapping = SaveFile::open(file, ramSize);
+    if (mapping == NULL) {
+        PrintMessage(Error, "Cartridge RAM will not be saved");
+        return false;
+    }
+    PrintMessage(Info, "Mapped save file " + file);
+    // A new save starts out with what RAM holds at power on
+    if (mapping->fresh) memcpy(mapping->data(), ram, ramSize);
+    save = mapping;
+    ram = save->data();
+    mapBanks();
+    return true;
+}
+
+void MMU::flushSave() {
+    if (save != NULL) save->flush();
+}
+
+void MMU::enableRam(bool enabled) {
+    if (ramEnabled && !enabled) flushSave();
+    ramEnabled = enabled;
+}
+
+template <class Controller>
+void MMU::attach() {
+    controllerWrite = &Controller::write;
+    controllerReadRam = &Controller::readRam;
+    controllerWriteRam = &Controller::writeRam;
+    controllerRamMapped = &Controller::ramMapped;
+    directRamWrites = Controller::directRamWrites;
+    romBank = 1;
+    lowRomBank = 0;
+    ramBank = 0;
+    ramEnabled = false;
+    bankRegister1 = 1;
+    bankRegister2 = 0;
+    bankingMode = 0;
+}
+
+// Points the 64 pages starting at firstPage at a 16 KB ROM bank
+void MMU::mapRom(uint8_t firstPage, uint32_t bank) {
+    uint8_t* base = const_cast<uint8_t*>(rom->data()) + bank * 0x4000;
+    for (int i = 0; i < 0x40; i++) {
+        pages[firstPage + i] = base + (i << 8);
+        updateReadPage(firstPage + i);
+    }
+}
+
+// Repoints the ROM and external RAM windows after a bank register changed
+void MMU::mapBanks() {
+    // The write that switched banks may come from the window it switched
+    uint16_t pc = cpu != NULL ? cpu->pc : 0;
+    const uint8_t* running = pages[pc >> 8];
+    if (rom != NULL) {
+        uint32_t banks = static_cast<uint32_t>(rom->size() / 0x4000);
+        romBank %= banks;
+        lowRomBank %= banks;
+        mapRom(0x00, lowRomBank);
+        mapRom(0x40, romBank);
+    }
+    else {
+        for (int page = 0; page < 0x80; page++) {
+            pages[page] = memory + (page << 8);
+            updateReadPage(page);
+        }
+    }
+    // The boot ROM covers the cartridge until it is unmapped, a CGB one 
+    // leaves the header at 0x0100-0x01FF visible
+    if (bootRomMapped) {
+        for (int page = 0; page < static_cast<int>(bootRom.size() >> 8); page++) {
+            if (page == 0x01) continue;
+            pages[page] = bootRom.data() + (page << 8);
+            updateReadPage(page);
+        }
+    }
+    // Unmapped RAM (disabled, missing or MBC3 clock registers) goes through the controller
+    bool mapped = ramMapped();
+    for (int page = 0xA0; page < 0xC0; page++) {
+        if (mapped) pages[page] = ram + (ramBank * 0x2000 + ((page - 0xA0) << 8)) % ramSize;
+        else pages[page] = memory + (page << 8);
+        updateReadPage(page);
+        updateWritePage(page);
+    }
+    if (blockCache != NULL && pc < 0x8000 && pages[pc >> 8] != running) blockCache->remap(pc);
+}
+
+void MMU::copyCartridgeState(const MMU& other) {
+    // Same cartridge, so the same amount of RAM
+    if (ramSize > 0) memcpy(ram, other.ram, ramSize);
+    romBank = other.romBank;
+    lowRomBank = other.lowRomBank;
+    ramBank = other.ramBank;
+    ramEnabled = other.ramEnabled;
+    bankRegister1 = other.bankRegister1;
+    bankRegister2 = other.bankRegister2;
+    bankingMode = other.bankingMode;
+    memcpy(clock, other.clock, sizeof(clock));
+    bootRom = other.bootRom;
+    bootRomMapped = other.bootRomMapped;
+    mapBanks();
+}
+
+bool MMU::loadBootRom(std::string file) {
+    PrintMessage(Info, "Loading boot ROM");
+    std::ifstream stream(file, std::ios::binary);
+    if (!stream) {
+        PrintMessage(Error, "Could not open " + file);
+        return false;
+    }
+    std::vector<uint8_t> image((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    // 256 bytes on DMG, 2304 on CGB (0x0000-0x00FF and 0x0200-0x08FF)
+    if (image.size() != 0x100 && image.size() != 0x900) {
+        PrintMessage(Error, file + " is not a DMG or CGB boot ROM");
+        return false;
+    }
+    bootRom = std::move(image);
+    bootRomMapped = true;
+    mapBanks();
+    return true;
+}
+
+// Writes that cannot go straight to a page, see writePages
+void MMU::write(uint16_t address, uint8_t value) {
+    if ((pageFlags[address >> 8] & PAGE_WATCH_WRITE) && writeWatchpoints.test(address)) hitWatchpoint(address);
+    if (dmaActive && address < 0xFF00) return;
+    if (address >= 0xFF00 && address < 0xFF80) writeIO(address, value);
+    else if (address >= 0xFF80) {
+        // HRAM and IE
+        memory[address] = value;
+        if (address == 0xFFFF) interruptsChanged = true;
+    }
+    else if (address < 0x8000) {
+        controllerWrite(*this, address, value);
+        return;
+    }
+    else if (address >= 0xA000 && address < 0xC000 && (!ramMapped() || !directRamWrites)) {
+        controllerWriteRam(*this, address, value);
+        return;
+    }
+    else if (address >= 0x8000 && address < 0xA000) {
+        if (memory[address] != value) {
+            if (address < 0x9800) dirtyTiles.set((address - 0x8000) >> 4);
+            else dirtyMapEntries.set(address - 0x9800);
+        }
+        memory[address] = value;
+    }
+    else if (address >= 0xFE00 && address < 0xFEA0) {
+        if (memory[address] != value) dirtySprites.set((address - 0xFE00) >> 2);
+        memory[address] = value;
+    }
+    else pages[address >> 8][address & 0xFF] = value;
+    uint8_t page = address >> 8;
+    if (codePages[page]) blockCache->invalidate(address);
+    uint8_t echo = echoPage(page);
+    if (codePages[echo]) blockCache->invalidate(static_cast<uint16_t>(address + ((echo - page) << 8)));
+}
+
+uint8_t MMU::read(uint16_t address) {
+    if ((pageFlags[address >> 8] & PAGE_WATCH_READ) && readWatchpoints.test(address)) hitWatchpoint(address);
+    return readHandler(address);
+}
+
+// Reads that cannot come straight from a page, see readPages
+uint8_t MMU::readHandler(uint16_t address) {
+    if (dmaActive && address < 0xFF00) return 0xFF;
+    if (address >= 0xFF00 && address < 0xFF80) return readIO(address);
+    if (address >= 0xA000 && address < 0xC000 && !ramMapped()) return controllerReadRam(*this, address);
+    return pages[address >> 8][address & 0xFF];
+}
+
+bool MMU::ramMapped() {
+    return controllerRamMapped(*this);
+}
+
+void MMU::markCode(uint8_t page, bool code) {
+    codePages[page] = code;
+    updateWritePage(page);
+    updateWritePage(echoPage(page));
+}
+
+// Pages are read directly unless a read may be computed (IO, e.g. TIMA, or 
+// unmapped cartridge RAM), DMA holds the bus or a watchpoint is set on them. 
+// HRAM is the exception on the IO page, see hramReadable
+void MMU::updateReadPage(uint8_t page) {
+    bool readable = page != 0xFF && !dmaActive && !(pageFlags[page] & PAGE_WATCH_READ);
+    if (page >= 0xA0 && page < 0xC0) readable = readable && ramMapped();
+    readPages[page] = readable ? pages[page] : NULL;
+    if (page == 0xFF) hramReadable = !(pageFlags[page] & PAGE_WATCH_READ);
+}
+
+// RAM pages (and HRAM) are written directly unless they (or their echo) 
+// hold cached code
+void MMU::updateWritePage(uint8_t page) {
+    // VRAM and OAM writes set dirty bits
+    bool writable = page >= 0xA0 && page < 0xFE;
+    if (page >= 0xA0 && page < 0xC0) writable = ramMapped() && directRamWrites;
+    writable = writable && !dmaActive && !(pageFlags[page] & PAGE_WATCH_WRITE);
+    writePages[page] = writable && !codePages[page] && !codePages[echoPage(page)] ? pages[page] : NULL;
+    if (page == 0xFF) hramWritable = !(pageFlags[page] & PAGE_WATCH_WRITE) && !codePages[page];
+}
+
+#define IO(writeMask, readMask) { writeMask, readMask, NULL, NULL }
+#define IO_WRITE(writeMask, readMask, writer) { writeMask, readMask, NULL, &MMU::writer }
+#define IO_UNUSED { 0x00, 0xFF, NULL, NULL }
+
+const MMU::IORegister MMU::ioRegisters[0x80] = {
+    IO(0x30, 0xCF),                                 // FF00 P1, no buttons are pressed
+    IO_WRITE(0xFF, 0x00, writeSerialData),          // FF01 SB
+    IO_WRITE(0x81, 0x7E, writeSerialControl),       // FF02 SC
+    IO_UNUSED,
+    { 0xFF, 0x00, &MMU::readDivider, &MMU::writeDivider }, // FF04 DIV
+    { 0xFF, 0x00, &MMU::readTimerCounter, &MMU::writeTimerCounter }, // FF05 TIMA
+    IO(0xFF, 0x00),                                 // FF06 TMA
+    IO_WRITE(0x07, 0xF8, writeTimerControl),        // FF07 TAC
+    IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED,
+    IO_WRITE(0x1F, 0xE0, writeInterruptFlags),      // FF0F IF
+    // Sound, write only bits read back as 1
+    IO(0x7F, 0x80), IO(0xFF, 0x3F), IO(0xFF, 0x00), IO(0xFF, 0xFF), IO(0xC7, 0xBF), // FF10 NR10-NR14
+    IO_UNUSED, IO(0xFF, 0x3F), IO(0xFF, 0x00), IO(0xFF, 0xFF), IO(0xC7, 0xBF),      // FF15 NR21-NR24
+    IO(0x80, 0x7F), IO(0xFF, 0xFF), IO(0x60, 0x9F), IO(0xFF, 0xFF), IO(0xC7, 0xBF), // FF1A NR30-NR34
+    IO_UNUSED, IO(0x3F, 0xFF), IO(0xFF, 0x00), IO(0xFF, 0x00), IO(0xC0, 0xBF),      // FF1F NR41-NR44
+    IO(0xFF, 0x00), IO(0xFF, 0x00), IO(0x80, 0x70),                                 // FF24 NR50-NR52
+    IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED,
+    // FF30 wave RAM
+    IO(0xFF, 0x00), IO(0xFF, 0x00), IO(0xFF, 0x00), IO(0xFF, 0x00), IO(0xFF, 0x00), IO(0xFF, 0x00), IO(0xFF, 0x00), IO(0xFF, 0x00),
+    IO(0xFF, 0x00), IO(0xFF, 0x00), IO(0xFF, 0x00), IO(0xFF, 0x00), IO(0xFF, 0x00), IO(0xFF, 0x00), IO(0xFF, 0x00), IO(0xFF, 0x00),
+    IO_WRITE(0xFF, 0x00, writeLcdControl),          // FF40 LCDC
+    IO_WRITE(0x78, 0x80, writeLcdStatus),           // FF41 STAT, the mode and coincidence bits are read only
+    IO_WRITE(0xFF, 0x00, writeLcdRegister),         // FF42 SCY
+    IO_WRITE(0xFF, 0x00, writeLcdRegister),         // FF43 SCX
+    IO(0x00, 0x00),                                 // FF44 LY is read only
+    IO_WRITE(0xFF, 0x00, writeLyCompare),           // FF45 LYC
+    IO_WRITE(0xFF, 0x00, writeDma),                 // FF46 DMA
+    IO_WRITE(0xFF, 0x00, writeLcdRegister),         // FF47 BGP
+    IO_WRITE(0xFF, 0x00, writeLcdRegister),         // FF48 OBP0
+    IO_WRITE(0xFF, 0x00, writeLcdRegister),         // FF49 OBP1
+    IO_WRITE(0xFF, 0x00, writeLcdRegister),         // FF4A WY
+    IO_WRITE(0xFF, 0x00, writeLcdRegister),         // FF4B WX
+    // FF4C-FF7F are unused (or CGB only) except for the boot ROM switch
+    IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED,
+    IO_WRITE(0x01, 0xFF, writeBootRomDisable),      // FF50
+    IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED,
+    IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED,
+    IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED,
+    IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED,
+    IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED,
+    IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED, IO_UNUSED,
+};
+
+#undef IO
+#undef IO_WRITE
+#undef IO_UNUSED
+
+uint8_t MMU::readIO(uint16_t address) {
+    const IORegister& reg = ioRegisters[address & 0x7F];
+    uint8_t value = reg.read != NULL ? (this->*reg.read)(address) : memory[address];
+    return value | reg.readMask;
+}
+
+void MMU::writeIO(uint16_t address, uint8_t value) {
+    const IORegister& reg = ioRegisters[address & 0x7F];
+    value = (memory[address] & ~reg.writeMask) | (value & reg.writeMask);
+    if (reg.write != NULL) (this->*reg.write)(address, value);
+    else memory[address] = value;
+}
+
+void MMU::writeSerialData(uint16_t address, uint8_t value) {
+    if (serialOutput) std::cout << value;
     memory[address] = value;
-    //if (address == 0xFF05) std::cout << +get(0xFF05);
 }
 
-uint8_t MMU::get(uint16_t address) {
-    return memory[address];
+// SC, a transfer on the internal clock completes after 8 bits
+void MMU::writeSerialControl(uint16_t address, uint8_t value) {
+    memory[address] = value;
+    if ((value & 0x81) == 0x81) scheduler.schedule(EVENT_SERIAL, scheduler.now + SERIAL_TRANSFER_CYCLES);
+    else scheduler.cancel(EVENT_SERIAL);
+}
+
+// DIV counts M-cycles since divBase, so it is computed from the clock
+uint8_t MMU::readDivider(uint16_t address) {
+    return static_cast<uint8_t>((scheduler.now - divBase) / DIV_PERIOD);
+}
+
+// Any write resets the divider and with it the timer's phase
+void MMU::writeDivider(uint16_t address, uint8_t value) {
+    uint8_t tima = peek(0xFF05);
+    divBase = scheduler.now;
+    restartTimer(tima, scheduler.now);
+}
+
+// While the timer runs TIMA is computed from the clock
+uint8_t MMU::readTimerCounter(uint16_t address) {
+    return memory[0xFF07] & 0x04 ? readTimer() : memory[address];
+}
+
+void MMU::writeTimerCounter(uint16_t address, uint8_t value) {
+    restartTimer(value, scheduler.now);
+}
+
+void MMU::writeTimerControl(uint16_t address, uint8_t value) {
+    uint8_t tima = peek(0xFF05);
+    memory[address] = value;
+    restartTimer(tima, scheduler.now);
+}
+
+void MMU::writeInterruptFlags(uint16_t address, uint8_t value) {
+    memory[address] = value;
+    interruptsChanged = true;
+}
+
+// The clock is still at the start of the writing instruction, the write itself lands later
+uint64_t MMU::writeTime(uint16_t address) {
+    return scheduler.now + (cpu != NULL ? cpu->writeCycle(address) : 0);
+}
+
+// The LCD restarts at line 0 when switched on
+void MMU::writeLcdControl(uint16_t address, uint8_t value) {
+    if (ppu != NULL) ppu->catchUp(address);
+    if ((value ^ memory[address]) & 0x80) {
+        memory[0xFF44] = 0;
+        if (value & 0x80) {
+            setMode(2);
+            scheduler.schedule(EVENT_MODE, scheduler.now + MODE2_CYCLES);
+            scheduler.schedule(EVENT_LINE, scheduler.now + CYCLES_PER_LINE);
+        }
+        else {
+            // Switching off in mode 3 cuts the line short
+            if (ppu != NULL && (memory[0xFF41] & 0x03) == 3) ppu->endLine();
+            setMode(0);
+            scheduler.cancel(EVENT_MODE);
+            scheduler.cancel(EVENT_LINE);
+        }
+    }
+    memory[address] = value;
+}
+
+// Registers the PPU reads while drawing, it draws up to now with the old value first
+void MMU::writeLcdRegister(uint16_t address, uint8_t value) {
+    if (ppu != NULL) ppu->catchUp(address);
+    memory[address] = value;
+}
+
+// Enabling a source that is already active raises the STAT interrupt
+void MMU::writeLcdStatus(uint16_t address, uint8_t value) {
+    setStatus(value);
+}
+
+void MMU::writeLyCompare(uint16_t address, uint8_t value) {
+    memory[address] = value;
+    setMode(memory[0xFF41] & 0x03);
+}
+
+/*
+	OAM DMA copies 160 bytes from value << 8 to OAM. The copy is done at 
+	once through the page table, and for the 160 M-cycles the transfer 
+	takes on hardware the CPU only reaches IO and HRAM: every other page 
+	loses its direct pointer and read()/write() see it as open bus until 
+	EVENT_DMA ends the transfer.
+*/
+void MMU::writeDma(uint16_t address, uint8_t value) {
+    memory[address] = value;
+    // A restarted transfer reads its source with the normal memory map
+    if (dmaActive) setDmaActive(false);
+    uint8_t buffer[0xA0];
+    const uint8_t* source = readPages[value];
+    if (source == NULL) {
+        for (int i = 0; i < 0xA0; i++) buffer[i] = peek(static_cast<uint16_t>(value << 8 | i));
+        source = buffer;
+    }
+    for (int sprite = 0; sprite < 40; sprite++) {
+        if (memcmp(memory + 0xFE00 + sprite * 4, source + sprite * 4, 4) != 0) dirtySprites.set(sprite);
+    }
+    memcpy(memory + 0xFE00, source, 0xA0);
+    if (codePages[0xFE]) {
+        for (uint16_t i = 0; i < 0xA0; i++) blockCache->invalidate(0xFE00 + i);
+    }
+    setDmaActive(true);
+    // The rest of a block running outside HRAM was decoded from the bus just lost
+    if (blockCache != NULL && cpu != NULL && cpu->pc < 0xFF00) blockCache->invalidate(cpu->pc);
+    scheduler.schedule(EVENT_DMA, scheduler.now + DMA_CYCLES);
+}
+
+// Takes the direct pointers of every page below IO/HRAM away for DMA, or gives them back
+void MMU::setDmaActive(bool active) {
+    dmaActive = active;
+    for (int page = 0; page < 0xFF; page++) {
+        updateReadPage(page);
+        updateWritePage(page);
+    }
+}
+
+void MMU::copyDmaState(const MMU& other) {
+    if (dmaActive != other.dmaActive) setDmaActive(other.dmaActive);
+}
+
+/*
+	Any write with bit 0 set unmaps the boot ROM for good. Repointing the 
+	overlaid pages is all it takes, reads never check for the boot ROM. 
+	Blocks decoded from it are keyed like the cartridge's, so the block 
+	cache starts over.
+*/
+void MMU::writeBootRomDisable(uint16_t address, uint8_t value) {
+    memory[address] = value;
+    if (!bootRomMapped || !(value & 0x01)) return;
+    bootRomMapped = false;
+    mapBanks();
+    if (blockCache != NULL) blockCache->flush();
+}
+
+void MMU::setBreakpoint(uint16_t address, bool enabled) {
+    breakpoints.set(address, enabled);
+    updatePageFlags(address >> 8);
+    // Blocks end before breakpoints, so every cached block has to be decoded again
+    if (blockCache != NULL) blockCache->flush();
+}
+
+void MMU::setWatchpoint(uint16_t address, bool read, bool write) {
+    readWatchpoints.set(address, read);
+    writeWatchpoints.set(address, write);
+    updatePageFlags(address >> 8);
+}
+
+void MMU::updatePageFlags(uint8_t page) {
+    pageFlags[page] = 0;
+    for (int i = 0; i < 0x100; i++) {
+        uint16_t address = static_cast<uint16_t>(page << 8 | i);
+        if (breakpoints.test(address)) pageFlags[page] |= PAGE_BREAKPOINT;
+        if (readWatchpoints.test(address)) pageFlags[page] |= PAGE_WATCH_READ;
+        if (writeWatchpoints.test(address)) pageFlags[page] |= PAGE_WATCH_WRITE;
+    }
+    updateReadPage(page);
+    updateWritePage(page);
+}
+
+// The access completes, the CPU stops once the instruction retires
+void MMU::hitWatchpoint(uint16_t address) {
+    watchpointHit = true;
+    watchpointAddress = address;
+    debugStop = true;
+    interruptsChanged = true;
+}
+
+void MMU::requestInterrupt(uint8_t interrupt) {
+    memory[0xFF0F] |= 1 << interrupt;
+    interruptsChanged = true;
+}
+
+// Runs every event that is due
+void MMU::runEvents() {
+    uint64_t when;
+    while (scheduler.next <= scheduler.now) {
+        Event event = scheduler.pop(when);
+        runEvent(event, when);
+    }
+}
+
+// Runs a single event at the time it was scheduled for
+void MMU::runEvent(Event event, uint64_t when) {
+    switch (event) {
+    case EVENT_TIMER:
+        restartTimer(memory[0xFF06], when);
+        requestInterrupt(2);
+        break;
+    case EVENT_LINE:
+        memory[0xFF44] = (memory[0xFF44] + 1) % 154;
+        if (memory[0xFF44] < 144) {
+            setMode(2);
+            scheduler.schedule(EVENT_MODE, when + MODE2_CYCLES);
+        }
+        else {
+            // LY still changes during VBlank and so may match LYC
+            setMode(1);
+            if (memory[0xFF44] == 144) {
+                requestInterrupt(0);
+                if (ppu != NULL) ppu->finishFrame();
+            }
+        }
+        scheduler.schedule(EVENT_LINE, when + CYCLES_PER_LINE);
+        break;
+    case EVENT_MODE:
+        if ((memory[0xFF41] & 0x03) == 2) {
+            uint64_t length = ppu != NULL ? ppu->startLine(memory[0xFF44], when) : SCANLINE_MODE3_CYCLES;
+            setMode(3);
+            scheduler.schedule(EVENT_MODE, when + length);
+        }
+        else {
+            if (ppu != NULL) ppu->endLine();
+            setMode(0);
+        }
+        break;
+    case EVENT_SERIAL:
+        // Nothing is connected, so the received byte reads as FF
+        memory[0xFF01] = 0xFF;
+        memory[0xFF02] &= 0x7F;
+        requestInterrupt(3);
+        break;
+    case EVENT_FRAME_SEQUENCER:
+        frameSequencerStep = (frameSequencerStep + 1) & 0x07;
+        scheduler.schedule(EVENT_FRAME_SEQUENCER, when + FRAME_SEQUENCER_PERIOD);
+        break;
+    case EVENT_DMA:
+        setDmaActive(false);
+        break;
+    default:
+        break;
+    }
+}
+
+// Whether the event may change the byte at address, IF included
+bool MMU::eventChanges(Event event, uint16_t address) {
+    switch (event) {
+    case EVENT_TIMER:
+        return address == 0xFF05 || address == 0xFF0F;
+    case EVENT_LINE:
+        return address == 0xFF41 || address == 0xFF44 || address == 0xFF0F;
+    case EVENT_MODE:
+        return address == 0xFF41 || address == 0xFF0F;
+    case EVENT_SERIAL:
+        return address == 0xFF01 || address == 0xFF02 || address == 0xFF0F;
+    case EVENT_DMA: // Everything below IO reads as open bus until then
+        return address < 0xFF00;
+    default:
+        return false;
+    }
+}
+
+// IF bits the event may request
+uint8_t MMU::eventInterrupts(Event event) {
+    switch (event) {
+    case EVENT_TIMER:
+        return 1 << 2;
+    case EVENT_LINE: // VBlank, and STAT for modes 2 and 1 and LY=LYC
+        return 1 << 0 | (memory[0xFF41] & 0x70 ? 1 << 1 : 0);
+    case EVENT_MODE: // STAT for mode 0
+        return memory[0xFF41] & 0x08 ? 1 << 1 : 0;
+    case EVENT_SERIAL:
+        return 1 << 3;
+    default:
+        return 0;
+    }
+}
+
+uint8_t MMU::readTimer() {
+    uint64_t period = timerPeriods[memory[0xFF07] & 0x03];
+    uint64_t ticks = (scheduler.now - divBase) / period - (timerStart - divBase) / period;
+    return static_cast<uint8_t>(timerValue + ticks);
+}
+
+// Sets TIMA at the given time and schedules its next overflow
+void MMU::restartTimer(uint8_t value, uint64_t when) {
+    memory[0xFF05] = value;
+    timerValue = value;
+    timerStart = when;
+    if (!(memory[0xFF07] & 0x04)) {
+        scheduler.cancel(EVENT_TIMER);
+        return;
+    }
+    uint64_t period = timerPeriods[memory[0xFF07] & 0x03];
+    uint64_t elapsed = (when - divBase) / period;
+    scheduler.schedule(EVENT_TIMER, divBase + (elapsed + 0x100 - value) * period);
+}
+
+// Sets the STAT mode and updates the LY=LYC bit for the current LY
+void MMU::setMode(uint8_t mode) {
+    uint8_t coincidence = memory[0xFF44] == memory[0xFF45] ? 0x04 : 0x00;
+    setStatus((memory[0xFF41] & 0xF8) | coincidence | mode);
+}
+
+/*
+	The STAT interrupt line is the OR of the sources enabled in STAT bits 
+	3-6 (modes 0, 1 and 2 and LY=LYC), and the interrupt is requested only 
+	when it goes from low to high. Its state follows from STAT alone, so 
+	comparing it before and after every change is enough.
+*/
+static bool statLine(uint8_t status) {
+    uint8_t mode = status & 0x03;
+    return (status & 0x08 && mode == 0) || (status & 0x10 && mode == 1) || (status & 0x20 && mode == 2)
+        || (status & 0x40 && status & 0x04);
+}
+
+void MMU::setStatus(uint8_t value) {
+    bool before = statLine(memory[0xFF41]);
+    memory[0xFF41] = value;
+    if (!before && statLine(value)) requestInterrupt(1);
 }
 
 void MMU::setBit(uint8_t& byte, uint8_t bit) {
@@ -68,5 +711,5 @@ uint8_t MMU::getBit(uint8_t byte, uint8_t bit) {
 }
 
 uint16_t MMU::formWord(uint8_t high, uint8_t low) {
-    return static_cast<uint16_t>(high << 8 | low & 0x00FF);
+    return static_cast<uint16_t>(high << 8 | (low & 0x00FF));
 }
\ No newline at end of file
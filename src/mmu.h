@@ -1,22 +1,147 @@
 #pragma once
 #include "definitions.h"
+#include "scheduler.h"
+#include "cartridge.h"
+
+#include <memory>
+#include <vector>
+
+class BlockCache;
+class CPU;
+class PPU;
+
+// pageFlags bits
+const uint8_t PAGE_BREAKPOINT = 0x01;
+const uint8_t PAGE_WATCH_READ = 0x02;
+const uint8_t PAGE_WATCH_WRITE = 0x04;
 
 class MMU {
 public:
 	MMU();
 	~MMU();
 	uint8_t memory[GB_MEMORY];
-	uint32_t romSize = 0;
 
-	std::bitset<5> interruptEnable;
-	std::bitset<5> interruptFlags;
-	std::bitset<5> interrupts;
+	// Cartridge, banked by the controller bound in insert()
+	std::shared_ptr<RomImage> rom;
+	// External RAM, the .sav mapping when battery backed and ramBuffer otherwise
+	uint8_t* ram = NULL;
+	size_t ramSize = 0;
+	std::vector<uint8_t> ramBuffer;
+	std::shared_ptr<SaveFile> save;
+	bool battery = false;
+	uint16_t romBank = 1;    // Bank in 0x4000-0x7FFF
+	uint16_t lowRomBank = 0; // Bank in 0x0000-0x3FFF
+	uint8_t ramBank = 0;
+	bool ramEnabled = false;
+	uint8_t bankRegister1 = 1;
+	uint8_t bankRegister2 = 0;
+	uint8_t bankingMode = 0;
+	uint8_t clock[5] = { 0 }; // MBC3 clock registers
+	void insert(std::shared_ptr<RomImage> image);
+	void mapBanks();
+	void copyCartridgeState(const MMU& other);
+	// Optional boot ROM mapped over the cartridge until FF50 is written
+	std::vector<uint8_t> bootRom;
+	bool bootRomMapped = false;
+	bool loadBootRom(std::string file);
+	// Moves external RAM into the .sav file, keeping ramBuffer on error
+	bool loadSave(std::string file);
+	// Starts writing back the save without waiting, at any idle point
+	void flushSave();
+	// Flushes the save when the game disables RAM, which it does after saving
+	void enableRam(bool enabled);
+
+	/*
+		Memory map in 256-byte pages. pages[] is the host memory behind each 
+		page (echo RAM shares WRAM's). readPages/writePages hold the same 
+		pointer where an access can go straight to it and NULL where it needs 
+		a handler: IO, the read-only ROM, VRAM and OAM (for their dirty bits) 
+		and pages holding cached code. ROM pages point into the read-only 
+		mapping and are never written.
+	*/
+	uint8_t* pages[0x100];
+	uint8_t* readPages[0x100];
+	uint8_t* writePages[0x100];
+	// HRAM shares page 0xFF with IO and IE, these stand in for its half page
+	bool hramReadable = true;
+	bool hramWritable = true;
+
+	// Pages holding cached code, writes to them invalidate blocks
+	uint8_t codePages[0x100];
+	BlockCache* blockCache = NULL;
+	void markCode(uint8_t page, bool code);
+
+	// Draws the visible lines and times their mode 3 when set
+	PPU* ppu = NULL;
+	// The CPU driving this bus. mapBanks() checks what runs under its pc, and
+	// it knows when within an instruction a write lands
+	CPU* cpu = NULL;
+	uint64_t writeTime(uint16_t address);
+
+	/*
+		Video memory written since a consumer (renderer, tile cache, state
+		hashing) last cleared the bits: one per 16-byte tile in 0x8000-0x97FF,
+		per entry of the tile maps at 0x9800-0x9FFF and per 4-byte sprite in
+		OAM. Only writes that change a byte set them. Everything starts dirty.
+	*/
+	std::bitset<384> dirtyTiles;
+	std::bitset<2048> dirtyMapEntries;
+	std::bitset<40> dirtySprites;
+
+	/*
+		Debugging. Breakpoints stop the CPU before the instruction at an 
+		address, watchpoints after the instruction that read or wrote one. 
+		pageFlags marks the pages holding any: watched pages lose their 
+		direct pointers, so only their accesses reach the check in read() or 
+		write(), and blocks end before a breakpoint, so only fetching a block 
+		that starts on one checks for it. Code on other pages runs as usual.
+	*/
+	std::bitset<0x10000> breakpoints;
+	std::bitset<0x10000> readWatchpoints;
+	std::bitset<0x10000> writeWatchpoints;
+	uint8_t pageFlags[0x100];
+	void setBreakpoint(uint16_t address, bool enabled);
+	void setWatchpoint(uint16_t address, bool read, bool write);
+	// What stopped the last batch early, cleared by the debugger
+	bool breakpointHit = false;
+	bool watchpointHit = false;
+	uint16_t watchpointAddress = 0;
+	// Asks the CPU to stop after the current instruction
+	bool debugStop = false;
+
+	// Set while OAM DMA holds the bus, see writeDma()
+	bool dmaActive = false;
+	void copyDmaState(const MMU& other);
+
+	bool serialOutput = true;
 
-	std::bitset<5> TAC;
+	// IE (0xFFFF) and IF (0xFF0F) are only kept in memory[]. Set whenever
+	// either or IME may have changed, so the CPU only looks for a pending
+	// interrupt when one could have become serviceable
+	bool interruptsChanged = true;
+	uint8_t pendingInterrupts();
 
-	void load(std::string file);
+	Scheduler scheduler;
+	// DIV is derived from the clock, counting from its last reset at
+	// divBase. While the timer runs so is TIMA: it held timerValue at
+	// timerStart and counts the TAC-selected ticks of the divider
+	uint64_t divBase = 0;
+	uint64_t timerStart = 0;
+	uint8_t timerValue = 0;
+	uint8_t frameSequencerStep = 0;
+	void runEvents();
+	void runEvent(Event event, uint64_t when);
+	bool eventChanges(Event event, uint16_t address);
+	uint8_t eventInterrupts(Event event);
+	void requestInterrupt(uint8_t interrupt);
+
+	// False (after reporting why) if the ROM is missing or truncated
+	bool load(std::string file);
 	void set(uint16_t address, uint8_t value);
-	uint8_t get(uint16_t);
+	uint8_t get(uint16_t address);
+	// Reads like get() without triggering watchpoints, for decoding and debuggers
+	uint8_t peek(uint16_t address);
+	static bool isHram(uint16_t address);
 
 	void setBit(uint8_t& byte, uint8_t bit);
 	void clearBit(uint8_t & byte, uint8_t bit);
@@ -26,4 +151,91 @@ public:
 	uint16_t formWord(uint8_t high, uint8_t low);
 
 	std::string title;
+
+private:
+	void (*controllerWrite)(MMU& mmu, uint16_t address, uint8_t value) = &NoController::write;
+	uint8_t (*controllerReadRam)(MMU& mmu, uint16_t address) = &NoController::readRam;
+	void (*controllerWriteRam)(MMU& mmu, uint16_t address, uint8_t value) = &NoController::writeRam;
+	bool (*controllerRamMapped)(const MMU& mmu) = &NoController::ramMapped;
+	bool directRamWrites = true;
+	template <class Controller> void attach();
+	void mapRom(uint8_t firstPage, uint32_t bank);
+
+	uint8_t read(uint16_t address);
+	uint8_t readHandler(uint16_t address);
+	void write(uint16_t address, uint8_t value);
+	bool ramMapped();
+	void updateReadPage(uint8_t page);
+	void updateWritePage(uint8_t page);
+	void updatePageFlags(uint8_t page);
+	void hitWatchpoint(uint16_t address);
+
+	/*
+		The IO registers 0xFF00-0xFF7F. A write only changes the bits in 
+		writeMask, read only bits keep their value, and reads return the 
+		stored byte with readMask (unused and write only bits) set. Registers 
+		with side effects have handlers: a write handler gets the merged 
+		value and stores it itself, a read handler replaces the stored byte.
+	*/
+	typedef uint8_t (MMU::*IORead)(uint16_t address);
+	typedef void (MMU::*IOWrite)(uint16_t address, uint8_t value);
+	struct IORegister {
+		uint8_t writeMask;
+		uint8_t readMask;
+		IORead read;
+		IOWrite write;
+	};
+	static const IORegister ioRegisters[0x80];
+	uint8_t readIO(uint16_t address);
+	void writeIO(uint16_t address, uint8_t value);
+	void writeSerialData(uint16_t address, uint8_t value);
+	void writeSerialControl(uint16_t address, uint8_t value);
+	uint8_t readDivider(uint16_t address);
+	void writeDivider(uint16_t address, uint8_t value);
+	uint8_t readTimerCounter(uint16_t address);
+	void writeTimerCounter(uint16_t address, uint8_t value);
+	void writeTimerControl(uint16_t address, uint8_t value);
+	void writeInterruptFlags(uint16_t address, uint8_t value);
+	void writeLcdControl(uint16_t address, uint8_t value);
+	void writeLcdStatus(uint16_t address, uint8_t value);
+	void writeLcdRegister(uint16_t address, uint8_t value);
+	void writeLyCompare(uint16_t address, uint8_t value);
+	void writeDma(uint16_t address, uint8_t value);
+	void writeBootRomDisable(uint16_t address, uint8_t value);
+	void setDmaActive(bool active);
+
+	uint8_t readTimer();
+	void restartTimer(uint8_t value, uint64_t when);
+	void setMode(uint8_t mode);
+	void setStatus(uint8_t value);
 };
+
+// FF80-FFFE, the only part of page 0xFF without side effects
+inline bool MMU::isHram(uint16_t address) {
+	return static_cast<uint16_t>(address - 0xFF80) < 0x7F;
+}
+
+inline uint8_t MMU::get(uint16_t address) {
+	const uint8_t* page = readPages[address >> 8];
+	if (page != NULL) return page[address & 0xFF];
+	if (isHram(address) && hramReadable) return memory[address];
+	return read(address);
+}
+
+inline uint8_t MMU::peek(uint16_t address) {
+	const uint8_t* page = readPages[address >> 8];
+	if (page != NULL) return page[address & 0xFF];
+	if (isHram(address) && hramReadable) return memory[address];
+	return readHandler(address);
+}
+
+inline uint8_t MMU::pendingInterrupts() {
+	return memory[0xFFFF] & memory[0xFF0F] & 0x1F;
+}
+
+inline void MMU::set(uint16_t address, uint8_t value) {
+	uint8_t* page = writePages[address >> 8];
+	if (page != NULL) page[address & 0xFF] = value;
+	else if (isHram(address) && hramWritable) memory[address] = value;
+	else write(address, value);
+}
@@ -0,0 +1,173 @@
+#include "pixelkernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_SSE2
+#define TARGET_AVX2
+#else
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+static void decodeTileScalar(const uint8_t* data, uint8_t* indices, uint8_t* flipped) {
+	for (int row = 0; row < 8; row++) {
+		uint8_t low = data[row * 2];
+		uint8_t high = data[row * 2 + 1];
+		for (int x = 0; x < 8; x++) {
+			int bit = 7 - x;
+			uint8_t index = ((low >> bit) & 1) | ((high >> bit) & 1) << 1;
+			indices[row * 8 + x] = index;
+			flipped[row * 8 + 7 - x] = index;
+		}
+	}
+}
+
+static void mapPaletteScalar(const uint8_t* indices, const uint16_t* palette, uint16_t* pixels, int count) {
+	for (int i = 0; i < count; i++) {
+		pixels[i] = palette[indices[i]];
+	}
+}
+
+static const PixelKernels scalarKernels = { "scalar", &decodeTileScalar, &mapPaletteScalar };
+
+#ifdef KERNELS_X86
+
+/*
+	A bit plane byte is repeated across a row's 8 lanes and each lane keeps 
+	the bit of its pixel: bit 7 for pixel 0, or bit 0 when mirrored. SSE2 
+	handles two rows per register and AVX2 four.
+*/
+TARGET_SSE2 static __m128i planeBits(__m128i bytes, __m128i mask, __m128i value) {
+	return _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(bytes, mask), mask), value);
+}
+
+TARGET_SSE2 static void decodeTileSse2(const uint8_t* data, uint8_t* indices, uint8_t* flipped) {
+	const __m128i mask = _mm_setr_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+	const __m128i flippedMask = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+	const __m128i one = _mm_set1_epi8(1);
+	const __m128i two = _mm_set1_epi8(2);
+	for (int row = 0; row < 8; row += 2) {
+		const uint8_t* pair = data + row * 2;
+		__m128i low = _mm_unpacklo_epi64(_mm_set1_epi8(pair[0]), _mm_set1_epi8(pair[2]));
+		__m128i high = _mm_unpacklo_epi64(_mm_set1_epi8(pair[1]), _mm_set1_epi8(pair[3]));
+		__m128i value = _mm_or_si128(planeBits(low, mask, one), planeBits(high, mask, two));
+		__m128i mirrored = _mm_or_si128(planeBits(low, flippedMask, one), planeBits(high, flippedMask, two));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(indices + row * 8), value);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(flipped + row * 8), mirrored);
+	}
+}
+
+// Eight pixels per step: each lane selects its colour with a compare per palette entry
+TARGET_SSE2 static void mapPaletteSse2(const uint8_t* indices, const uint16_t* palette, uint16_t* pixels, int count) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i colours[4];
+	for (int i = 0; i < 4; i++) {
+		colours[i] = _mm_set1_epi16(static_cast<short>(palette[i]));
+	}
+	for (int i = 0; i < count; i += 8) {
+		__m128i index = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + i)), zero);
+		__m128i result = _mm_and_si128(_mm_cmpeq_epi16(index, zero), colours[0]);
+		result = _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi16(index, _mm_set1_epi16(1)), colours[1]));
+		result = _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi16(index, _mm_set1_epi16(2)), colours[2]));
+		result = _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi16(index, _mm_set1_epi16(3)), colours[3]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), result);
+	}
+}
+
+TARGET_AVX2 static __m256i planeBits(__m256i bytes, __m256i mask, __m256i value) {
+	return _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(bytes, mask), mask), value);
+}
+
+// The bit plane byte of each of four rows repeated over 8 lanes
+TARGET_AVX2 static __m256i repeatRows(const uint8_t* data, int plane) {
+	__m128i first = _mm_unpacklo_epi64(_mm_set1_epi8(data[plane]), _mm_set1_epi8(data[2 + plane]));
+	__m128i second = _mm_unpacklo_epi64(_mm_set1_epi8(data[4 + plane]), _mm_set1_epi8(data[6 + plane]));
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+}
+
+TARGET_AVX2 static void decodeTileAvx2(const uint8_t* data, uint8_t* indices, uint8_t* flipped) {
+	const __m256i mask = _mm256_setr_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1,
+		-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+	const __m256i flippedMask = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+		1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+	const __m256i one = _mm256_set1_epi8(1);
+	const __m256i two = _mm256_set1_epi8(2);
+	for (int row = 0; row < 8; row += 4) {
+		__m256i low = repeatRows(data + row * 2, 0);
+		__m256i high = repeatRows(data + row * 2, 1);
+		__m256i value = _mm256_or_si256(planeBits(low, mask, one), planeBits(high, mask, two));
+		__m256i mirrored = _mm256_or_si256(planeBits(low, flippedMask, one), planeBits(high, flippedMask, two));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(indices + row * 8), value);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(flipped + row * 8), mirrored);
+	}
+}
+
+/*
+	32 pixels per step. The low and high bytes of the palette colours are 
+	looked up with a byte shuffle each and interleaved back into 16-bit 
+	pixels; the interleave works within 128-bit lanes, so the two halves 
+	are put back in order before storing. Leftover spans of 8 use SSE2.
+*/
+TARGET_AVX2 static void mapPaletteAvx2(const uint8_t* indices, const uint16_t* palette, uint16_t* pixels, int count) {
+	uint8_t lowBytes[16] = {};
+	uint8_t highBytes[16] = {};
+	for (int i = 0; i < 4; i++) {
+		lowBytes[i] = palette[i] & 0xFF;
+		highBytes[i] = palette[i] >> 8;
+	}
+	const __m256i lowTable = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lowBytes)));
+	const __m256i highTable = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(highBytes)));
+	int i = 0;
+	for (; i + 32 <= count; i += 32) {
+		__m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+		__m256i low = _mm256_shuffle_epi8(lowTable, index);
+		__m256i high = _mm256_shuffle_epi8(highTable, index);
+		__m256i first = _mm256_unpacklo_epi8(low, high);
+		__m256i second = _mm256_unpackhi_epi8(low, high);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + i), _mm256_permute2x128_si256(first, second, 0x20));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + i + 16), _mm256_permute2x128_si256(first, second, 0x31));
+	}
+	if (i < count) mapPaletteSse2(indices + i, palette, pixels + i, count - i);
+}
+
+static const PixelKernels sse2Kernels = { "SSE2", &decodeTileSse2, &mapPaletteSse2 };
+static const PixelKernels avx2Kernels = { "AVX2", &decodeTileAvx2, &mapPaletteAvx2 };
+
+static bool cpuSupports(bool avx2) {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int leaves = info[0];
+	__cpuid(info, 1);
+	if (!avx2) return (info[3] & (1 << 26)) != 0;
+	// AVX registers also need saving by the OS (OSXSAVE and XCR0 bits 1-2)
+	if (leaves < 7 || !(info[2] & (1 << 27)) || (_xgetbv(0) & 0x06) != 0x06) return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return avx2 ? __builtin_cpu_supports("avx2") : __builtin_cpu_supports("sse2");
+#endif
+}
+
+#endif
+
+const std::vector<const PixelKernels*>& supportedKernels() {
+	// Built once, the static initialization is thread-safe
+	static const std::vector<const PixelKernels*> kernels = [] {
+		std::vector<const PixelKernels*> supported = { &scalarKernels };
+#ifdef KERNELS_X86
+		if (cpuSupports(false)) supported.push_back(&sse2Kernels);
+		if (cpuSupports(true)) supported.push_back(&avx2Kernels);
+#endif
+		return supported;
+	}();
+	return kernels;
+}
+
+const PixelKernels* bestKernels() {
+	return supportedKernels().back();
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "definitions.h"
+
+#include <vector>
+
+/*
+	The PPU's inner loops as a set of function pointers: a scalar version
+	that runs anywhere and, on x86, SSE2 and AVX2 versions. Which ones the
+	CPU can run is checked once at run time, every set gives the same
+	results.
+*/
+struct PixelKernels {
+	const char* name;
+	// Interleaves the bit planes of a tile's 16 bytes into 8x8 colour
+	// indices, and into flipped mirrored horizontally
+	void (*decodeTile)(const uint8_t* data, uint8_t* indices, uint8_t* flipped);
+	// Writes the palette colour of count indices (0-3), count a multiple of 8
+	void (*mapPalette)(const uint8_t* indices, const uint16_t* palette, uint16_t* pixels, int count);
+};
+
+// The sets this CPU supports, the scalar one first and the fastest last
+const std::vector<const PixelKernels*>& supportedKernels();
+const PixelKernels* bestKernels();
@@ -1,61 +1,157 @@
 #include "ppu.h"
+#include "mmu.h"
 
-PPU::PPU(const char* title) {
-	window = SDL_CreateWindow(title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, GB_HEIGHT * 4, GB_WIDTH * 4, NULL);
-	renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB4444, SDL_TEXTUREACCESS_STREAMING, GB_WIDTH, GB_HEIGHT);
-	SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0x00);
-	SDL_RenderClear(renderer);
-	
+#include <algorithm>
+
+const uint16_t PPU::shades[4] = { 0xFFFF, 0xFAAA, 0xF555, 0xF000 };
+
+PPU::PPU(MMU* mmu) {
+	this->mmu = mmu;
+	this->kernels = bestKernels();
+	attach<ScanlineRenderer>();
+	mmu->ppu = this;
 }
 
 PPU::~PPU() {
-	SDL_DestroyTexture(texture);
-	SDL_DestroyRenderer(renderer);
-	SDL_DestroyWindow(window);
+	mmu->ppu = NULL;
 }
 
-void PPU::setPixel(uint16_t x, uint16_t y, uint16_t colour) {
-	int16_t pixel = y * GB_WIDTH + x;
-	pixelbuffer[pixel] = colour;
+void PPU::copyRenderer(const PPU& other) {
+	rendererStartLine = other.rendererStartLine;
+	rendererCatchUp = other.rendererCatchUp;
+	rendererEndLine = other.rendererEndLine;
+}
+
+uint64_t ScanlineRenderer::startLine(PPU& ppu, uint8_t line, uint64_t when) {
+	ppu.renderLine(line);
+	return SCANLINE_MODE3_CYCLES;
+}
+
+void ScanlineRenderer::catchUp(PPU& ppu, uint16_t address) {}
+
+void ScanlineRenderer::endLine(PPU& ppu) {}
+
+// BGP, OBP0 and OBP1 hold a 2-bit shade for each colour index
+void PPU::decodePalette(uint8_t value, uint16_t palette[4]) {
+	for (int i = 0; i < 4; i++) {
+		palette[i] = shades[(value >> (i * 2)) & 0x03];
+	}
 }
 
-void PPU::render() {
-	SDL_UpdateTexture(texture, nullptr, pixelbufferReady, 2 * GB_WIDTH);
-	SDL_RenderCopy(renderer, texture, nullptr, nullptr);
-	SDL_RenderPresent(renderer);
+// Decodes the tiles written since the last line
+void PPU::updateTiles() {
+	if (mmu->dirtyTiles.none()) return;
+	for (int tile = 0; tile < 384; tile++) {
+		if (mmu->dirtyTiles[tile]) decodeTile(tile);
+	}
+	mmu->dirtyTiles.reset();
 }
 
-uint8_t PPU::getBit(uint8_t bit, uint16_t address) {
-	return (address >> bit) & 0x1;
+void PPU::decodeTile(int tile) {
+	kernels->decodeTile(mmu->memory + 0x8000 + tile * 16, &decodedTiles[tile][0][0], &flippedTiles[tile][0][0]);
 }
 
-void PPU::update(uint8_t memory[]) {
-	backgroundTable = (getBit(memory[0xFF40], 3)) ? 0x9C00 : 0x9800;
-	windowTable = (getBit(memory[0xFF40], 6)) ? 0x9C00 : 0x9800;
-	addressingMode = getBit(memory[0xFF40], 4);
+// LCDC bit 4 selects unsigned tile numbers from 0x8000 or signed ones around 0x9000
+int PPU::tileIndex(uint8_t lcdc, uint8_t tile) {
+	if (lcdc & 0x10) return tile;
+	return 256 + static_cast<int8_t>(tile);
+}
 
-	if ((LCDC >> 0) & 0x1) {
-		paletteBackground[0] = getBit(memory[0xFF47], 0) | getBit(memory[0xFF47], 1) << 1;
-		paletteBackground[1] = getBit(memory[0xFF47], 2) | getBit(memory[0xFF47], 3) << 1;
-		paletteBackground[2] = getBit(memory[0xFF47], 4) | getBit(memory[0xFF47], 5) << 1;
-		paletteBackground[3] = getBit(memory[0xFF47], 6) | getBit(memory[0xFF47], 7) << 1;
+/*
+	Fills indices from start to the end of the line with the colour indices 
+	of one row of a tile map. Screen x shows map pixel (x + offset) & 0xFF, 
+	which wraps the background around and places the window at WX - 7.
+*/
+void PPU::renderTiles(uint8_t* indices, int start, uint16_t mapRow, uint8_t row, int offset, uint8_t lcdc) {
+	const uint8_t* memory = mmu->memory;
+	int x = start;
+	while (x < GB_WIDTH) {
+		uint8_t mapX = static_cast<uint8_t>(x + offset);
+		const uint8_t* pixels = decodedTiles[tileIndex(lcdc, memory[mapRow + (mapX >> 3)])][row & 7];
+		// The first and last tile may be cut off by the scroll
+		int first = mapX & 7;
+		int count = std::min(8 - first, GB_WIDTH - x);
+		memcpy(indices + x, pixels + first, count);
+		x += count;
 	}
+}
 
-	if ((LCDC >> 1) & 0x1) {
-		// Lower two bits are ignored because they are transparency values for sprites
-		paletteSprite0[1] = getBit(memory[0xFF48], 2) | getBit(memory[0xFF48], 3) << 1;
-		paletteSprite0[2] = getBit(memory[0xFF48], 4) | getBit(memory[0xFF48], 5) << 1;
-		paletteSprite0[3] = getBit(memory[0xFF48], 6) | getBit(memory[0xFF48], 7) << 1;
-		
-		paletteSprite1[1] = getBit(memory[0xFF49], 2) | getBit(memory[0xFF49], 3) << 1;
-		paletteSprite1[2] = getBit(memory[0xFF49], 4) | getBit(memory[0xFF49], 5) << 1;
-		paletteSprite1[3] = getBit(memory[0xFF49], 6) | getBit(memory[0xFF49], 7) << 1;
+// OAM search: the first 10 sprites in OAM on the line, ordered by X and then OAM index
+int PPU::findSprites(uint8_t line, uint8_t lcdc, uint8_t sprites[10]) {
+	const uint8_t* oam = mmu->memory + 0xFE00;
+	int height = lcdc & 0x04 ? 16 : 8;
+	int count = 0;
+	for (int i = 0; i < 40 && count < 10; i++) {
+		int y = oam[i * 4] - 16;
+		if (line >= y && line < y + height) sprites[count++] = i;
 	}
+	std::stable_sort(sprites, sprites + count, [oam](uint8_t a, uint8_t b) { return oam[a * 4 + 1] < oam[b * 4 + 1]; });
+	return count;
 }
 
+/*
+	Draws the line's sprites. Where they overlap the one with the lower X 
+	wins, then the one earlier in OAM, even when it is hidden behind the 
+	background (attribute bit 7, only background colour 0 is drawn over).
+*/
+void PPU::renderSprites(uint8_t line, uint8_t lcdc, const uint8_t* indices, uint16_t* pixels) {
+	const uint8_t* oam = mmu->memory + 0xFE00;
+	int height = lcdc & 0x04 ? 16 : 8;
+	uint8_t sprites[10];
+	int count = findSprites(line, lcdc, sprites);
 
+	bool covered[GB_WIDTH] = {};
+	for (int i = 0; i < count; i++) {
+		const uint8_t* sprite = oam + sprites[i] * 4;
+		uint8_t attributes = sprite[3];
+		int row = line - (sprite[0] - 16);
+		if (attributes & 0x40) row = height - 1 - row;
+		// 8x16 sprites ignore bit 0 of the tile number
+		int tile = (height == 16 ? sprite[2] & 0xFE : sprite[2]) + (row >> 3);
+		const uint8_t* pattern = (attributes & 0x20 ? flippedTiles : decodedTiles)[tile][row & 7];
+		const uint16_t* palette = attributes & 0x10 ? paletteSprite1 : paletteSprite0;
+		for (int column = 0; column < 8; column++) {
+			int x = sprite[1] - 8 + column;
+			if (x < 0 || x >= GB_WIDTH || covered[x]) continue;
+			uint8_t index = pattern[column];
+			// Colour 0 is transparent
+			if (index == 0) continue;
+			covered[x] = true;
+			if (!(attributes & 0x80) || indices[x] == 0) pixels[x] = palette[index];
+		}
+	}
+}
 
+void PPU::renderLine(uint8_t line) {
+	const uint8_t* memory = mmu->memory;
+	uint8_t lcdc = memory[0xFF40];
+	if (line == 0) windowLine = 0;
+	updateTiles();
+	decodePalette(memory[0xFF47], paletteBackground);
+	decodePalette(memory[0xFF48], paletteSprite0);
+	decodePalette(memory[0xFF49], paletteSprite1);
 
+	// Colour indices before the palette, sprites behind the background need them
+	uint8_t indices[GB_WIDTH] = {};
+	// LCDC bit 0 blanks the background and the window on the DMG
+	if (lcdc & 0x01) {
+		uint8_t y = static_cast<uint8_t>(memory[0xFF42] + line);
+		uint16_t backgroundMap = lcdc & 0x08 ? 0x9C00 : 0x9800;
+		renderTiles(indices, 0, backgroundMap + (y >> 3) * 32, y, memory[0xFF43], lcdc);
 
+		uint8_t wy = memory[0xFF4A];
+		uint8_t wx = memory[0xFF4B];
+		if ((lcdc & 0x20) && line >= wy && wx < GB_WIDTH + 7) {
+			uint16_t windowMap = lcdc & 0x40 ? 0x9C00 : 0x9800;
+			renderTiles(indices, std::max(wx - 7, 0), windowMap + (windowLine >> 3) * 32, windowLine, 7 - wx, lcdc);
+			windowLine++;
+		}
+	}
+	kernels->mapPalette(indices, paletteBackground, pixelbuffer + line * GB_WIDTH, GB_WIDTH);
+
+	if (lcdc & 0x02) renderSprites(line, lcdc, indices, pixelbuffer + line * GB_WIDTH);
+}
 
+void PPU::finishFrame() {
+	memcpy(pixelbufferReady, pixelbuffer, sizeof(pixelbuffer));
+}
@@ -1,33 +1,156 @@
 #pragma once
-#include <SDL.h>
 #include "definitions.h"
+#include "pixelkernels.h"
 
+class MMU;
+
+// Mode 3 of a line as drawn by ScanlineRenderer, and its shortest length on hardware
+const uint64_t SCANLINE_MODE3_CYCLES = 43;
+
+/*
+	State of the pixel FIFOs and the fetcher for the line in mode 3. Dots
+	count from the start of mode 3; the background FIFO is refilled with a
+	whole tile once it runs empty, the sprite FIFO holds the pixels of
+	fetched sprites still ahead of x.
+*/
+struct FifoState {
+	bool active = false;
+	uint8_t line = 0;
+	uint64_t start = 0;     // M-cycle mode 3 started at
+	int dot = 0;
+	int x = 0;              // Next pixel on the line
+	int discard = 0;        // Background pixels still to drop for SCX and WX < 7
+	int delay = 0;          // Dots left of the first fetch, which is thrown away
+	bool window = false;    // The fetcher has switched to the window
+	bool windowShown = false;
+	uint8_t fetchX = 0;     // Tile column the fetcher reads next
+	int fetchStep = 0;      // Dots into the current tile fetch
+	uint8_t tile = 0;
+	uint8_t background[8];
+	int backgroundHead = 0;
+	int backgroundCount = 0;
+	uint8_t spriteIndices[8];
+	uint8_t spriteAttributes[8];
+	int spriteCount = 0;
+	uint8_t sprites[10];    // OAM indices of the line's sprites, by X
+	int spriteTotal = 0;
+	int nextSprite = 0;
+	int spriteDots = 0;     // Dots left of the sprite fetch stalling output
+	uint16_t* output = NULL; // Line in the framebuffer, NULL while only timing it
+};
+
+class PPU;
+
+/*
+	How lines are drawn, bound with PPU::attach<Renderer>() when the PPU is
+	created. The MMU's events call startLine when a line enters mode 3, which
+	returns how long mode 3 lasts, and endLine when it leaves it; writes to
+	the LCD registers call catchUp first with the register written. Each
+	renderer's functions are its own, so the scanline renderer runs none of
+	the FIFO's per-dot code and never works out when a write lands.
+*/
+struct ScanlineRenderer {
+	// Draws the whole line at once, mode 3 always takes the shortest time
+	static uint64_t startLine(PPU& ppu, uint8_t line, uint64_t when);
+	static void catchUp(PPU& ppu, uint16_t address);
+	static void endLine(PPU& ppu);
+};
+
+/*
+	Dot accurate: the background fetcher, both pixel FIFOs, the window 
+	switch and sprite fetches are stepped one dot at a time, so mode 3 gets 
+	longer with SCX, the window and sprites. Pixels are only produced when 
+	something needs them: up to the current dot before an LCD register 
+	changes, and the rest of the line when mode 3 ends. Register writes in 
+	the middle of a line show up from the pixel they happen at.
+*/
+struct FifoRenderer {
+	static uint64_t startLine(PPU& ppu, uint8_t line, uint64_t when);
+	static void catchUp(PPU& ppu, uint16_t address);
+	static void endLine(PPU& ppu);
+
+	static void step(PPU& ppu, FifoState& state);
+	static void fetch(PPU& ppu, FifoState& state);
+	static void fetchSprite(PPU& ppu, FifoState& state);
+	static void output(PPU& ppu, FifoState& state);
+};
+
+/*
+	The emulation side of the LCD. It only reads emulated memory and writes
+	ARGB4444 pixels into its framebuffer, it has no window and depends on
+	nothing outside the core, so headless builds link it without SDL.
+	Showing a frame is up to the frontend (Display in the SDL build).
+
+	Timing stays with the MMU's line and mode events, only the length of 
+	mode 3 comes from the renderer. The frame is published at VBlank.
+
+	Lines are drawn from tiles decoded to one colour index per pixel, in
+	both horizontal orientations. A tile is decoded again only after
+	MMU::dirtyTiles says its 16 bytes changed, which on a static screen is
+	never.
+*/
 class PPU {
 	public:
-		PPU(const char* title);
+		// Draws with ScanlineRenderer until another renderer is attached
+		PPU(MMU* mmu);
 		~PPU();
 
-		void render();
-		void update(uint8_t memory[]);
+		// Binds ScanlineRenderer or FifoRenderer, before any line is drawn
+		template <class Renderer> void attach();
+		// Binds the renderer other uses
+		void copyRenderer(const PPU& other);
+
+		uint64_t startLine(uint8_t line, uint64_t when) { return rendererStartLine(*this, line, when); }
+		void catchUp(uint16_t address) { rendererCatchUp(*this, address); }
+		void endLine() { rendererEndLine(*this); }
+		// Makes the lines drawn so far the completed frame
+		void finishFrame();
+
+		// The last completed frame, GB_HEIGHT rows of GB_WIDTH pixels
+		const uint16_t* frame() const { return pixelbufferReady; }
+
+		// Tile decoding and palette lookup, the fastest set the CPU supports by default
+		const PixelKernels* kernels;
 	private:
-		uint16_t LCDC = 0;
-		uint16_t backgroundTable;
-		uint16_t windowTable;
-		uint16_t addressingMode;
+		friend struct ScanlineRenderer;
+		friend struct FifoRenderer;
+
+		// The four DMG shades from white to black
+		static const uint16_t shades[4];
+
+		MMU* mmu;
+		uint64_t (*rendererStartLine)(PPU& ppu, uint8_t line, uint64_t when);
+		void (*rendererCatchUp)(PPU& ppu, uint16_t address);
+		void (*rendererEndLine)(PPU& ppu);
+		FifoState fifo;
+
+		// Line of the window to draw next, it only advances on lines showing it
+		uint8_t windowLine = 0;
 
-		uint8_t paletteSprite0[4];
-		uint8_t paletteSprite1[4];
-		uint8_t paletteBackground[4];
+		// Colour indices of the 384 tiles at 0x8000-0x97FF, as is and mirrored
+		uint8_t decodedTiles[384][8][8];
+		uint8_t flippedTiles[384][8][8];
 
-		SDL_Window* window;
-		SDL_Renderer* renderer;
-		SDL_Texture* texture;
+		uint16_t paletteBackground[4];
+		uint16_t paletteSprite0[4];
+		uint16_t paletteSprite1[4];
 
-		uint16_t pixelbuffer[GB_HEIGHT * GB_WIDTH];
-		uint16_t pixelbufferReady[GB_HEIGHT * GB_WIDTH];
+		uint16_t pixelbuffer[GB_HEIGHT * GB_WIDTH] = {};
+		uint16_t pixelbufferReady[GB_HEIGHT * GB_WIDTH] = {};
 
-		void setPixel(uint16_t x, uint16_t y, uint16_t colour);
-		uint8_t getBit(uint8_t bit, uint16_t address);
-		
+		void renderLine(uint8_t line);
+		void decodePalette(uint8_t value, uint16_t palette[4]);
+		void updateTiles();
+		void decodeTile(int tile);
+		int tileIndex(uint8_t lcdc, uint8_t tile);
+		int findSprites(uint8_t line, uint8_t lcdc, uint8_t sprites[10]);
+		void renderTiles(uint8_t* indices, int start, uint16_t mapRow, uint8_t row, int offset, uint8_t lcdc);
+		void renderSprites(uint8_t line, uint8_t lcdc, const uint8_t* indices, uint16_t* pixels);
 };
 
+template <class Renderer>
+void PPU::attach() {
+	rendererStartLine = &Renderer::startLine;
+	rendererCatchUp = &Renderer::catchUp;
+	rendererEndLine = &Renderer::endLine;
+}
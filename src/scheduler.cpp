@@ -0,0 +1,44 @@
+#include "scheduler.h"
+
+void Scheduler::schedule(Event event, uint64_t when) {
+	cancel(event);
+	// Events due at the same time keep the order they were scheduled in
+	int i = size++;
+	while (i > 0 && queue[i - 1].when > when) {
+		queue[i] = queue[i - 1];
+		i--;
+	}
+	queue[i].when = when;
+	queue[i].event = event;
+	next = queue[0].when;
+}
+
+void Scheduler::cancel(Event event) {
+	for (int i = 0; i < size; i++) {
+		if (queue[i].event != event) continue;
+		size--;
+		for (; i < size; i++) queue[i] = queue[i + 1];
+		break;
+	}
+	next = size > 0 ? queue[0].when : NEVER;
+}
+
+bool Scheduler::isScheduled(Event event) {
+	for (int i = 0; i < size; i++) {
+		if (queue[i].event == event) return true;
+	}
+	return false;
+}
+
+Event Scheduler::peek() {
+	return queue[0].event;
+}
+
+Event Scheduler::pop(uint64_t& when) {
+	Event event = queue[0].event;
+	when = queue[0].when;
+	size--;
+	for (int i = 0; i < size; i++) queue[i] = queue[i + 1];
+	next = size > 0 ? queue[0].when : NEVER;
+	return event;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "definitions.h"
+
+const uint64_t NEVER = UINT64_MAX;
+
+enum Event {
+	EVENT_TIMER,           // TIMA overflows and reloads from TMA
+	EVENT_LINE,            // LY advances to the next line
+	EVENT_MODE,            // STAT mode 2 -> 3 -> 0 within a visible line
+	EVENT_SERIAL,          // A serial transfer clocked by us completes
+	EVENT_FRAME_SEQUENCER, // APU frame sequencer step (512 Hz)
+	EVENT_DMA,             // OAM DMA ends and the CPU sees the bus again
+	EVENT_COUNT
+};
+
+/*
+	Master clock and the hardware events due on it, in M-cycles since power
+	on. Every event type is pending at most once and the queue is kept
+	sorted by due time, so the CPU only compares now against next after an
+	instruction and components run when something actually happens instead
+	of being polled.
+*/
+class Scheduler {
+public:
+	uint64_t now = 0;
+	uint64_t next = NEVER; // Due time of the earliest pending event
+
+	void schedule(Event event, uint64_t when);
+	void cancel(Event event);
+	bool isScheduled(Event event);
+	// The earliest pending event, only valid while next != NEVER
+	Event peek();
+	// Removes the earliest event, only valid while next <= now
+	Event pop(uint64_t& when);
+
+private:
+	struct Entry {
+		uint64_t when;
+		Event event;
+	};
+	Entry queue[EVENT_COUNT];
+	int size = 0;
+};
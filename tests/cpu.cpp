@@ -0,0 +1,63 @@
+#include "testrom.h"
+#include "mmu.h"
+#include "cpu.h"
+
+// HALT with only the timer enabled sleeps through LY changes in one step
+static int testHaltSkipsToTimer() {
+	int failures = 0;
+	std::vector<uint8_t> rom = blankRom();
+	place(rom, 0x100, {
+		0xF3,       // DI
+		0x3E, 0x04, // LD A,4
+		0xE0, 0xFF, // LDH (IE),A
+		0x3E, 0x05, // LD A,5
+		0xE0, 0x07, // LDH (TAC),A, TIMA counts every 4 M-cycles
+		0xAF,       // XOR A
+		0xE0, 0x0F, // LDH (IF),A
+		0x76,       // HALT
+		0x18, 0xFE, // JR -2
+	});
+	MMU* mmu = new MMU();
+	mmu->load(writeRom("halt_timer", rom));
+	CPU* cpu = new CPU(mmu);
+	cpu->cycleBudget = CYCLES_PER_FRAME;
+	while (!cpu->halted && cpu->pc < 0x10E) cpu->execute(1);
+	CHECK(cpu->halted);
+	uint64_t start = mmu->scheduler.now;
+	cpu->execute(1);
+	CHECK(mmu->memory[0xFF0F] & 0x04);
+	CHECK(mmu->scheduler.now - start <= 256 * 4);
+	CHECK(mmu->scheduler.now - start > 250 * 4);
+	delete cpu;
+	delete mmu;
+	return failures;
+}
+
+// Starting DMA from ROM cuts the CPU off from the rest of its block
+static int testDmaEndsBlock() {
+	int failures = 0;
+	std::vector<uint8_t> rom = blankRom();
+	place(rom, 0x100, {
+		0x3E, 0xC0, // LD A,C0
+		0xE0, 0x46, // LDH (DMA),A
+		0x06, 0x55, // LD B,55
+		0x18, 0xFE, // JR -2
+	});
+	MMU* mmu = new MMU();
+	CHECK(mmu->load(writeRom("dma_block", rom)));
+	CPU* cpu = new CPU(mmu);
+	cpu->cycleBudget = CYCLES_PER_FRAME;
+	cpu->execute(1);
+	cpu->B = 0;
+	cpu->execute(2);
+	// The bus reads 0xFF, which is RST 38
+	CHECK(cpu->B == 0);
+	CHECK(cpu->pc == 0x0038);
+	delete cpu;
+	delete mmu;
+	return failures;
+}
+
+int main() {
+	return testHaltSkipsToTimer() + testDmaEndsBlock() > 0;
+}
@@ -0,0 +1,131 @@
+#include "testrom.h"
+#include "mmu.h"
+#include "cpu.h"
+#include "jit.h"
+
+#include <random>
+
+// EI in native code has to let a pending interrupt in at the next retire
+static int testEnableInterrupts() {
+	int failures = 0;
+	std::vector<uint8_t> rom = blankRom();
+	place(rom, 0x100, {
+		0xF3,       // loop: DI
+		0x3E, 0x04, // LD A,4
+		0xE0, 0x0F, // LDH (IF),A
+		0xE0, 0xFF, // LDH (IE),A
+		0xFB,       // EI
+		0x00,       // NOP, the timer interrupt is taken here
+		0xF0, 0x81, // LDH A,(81)
+		0x3C,       // INC A
+		0xE0, 0x81, // LDH (81),A
+		0x18, 0xF0, // JR loop
+	});
+	// Timer handler counts in FF80
+	place(rom, 0x50, { 0xF5, 0xF0, 0x80, 0x3C, 0xE0, 0x80, 0xF1, 0xD9 });
+	std::string file = writeRom("jit_ei", rom);
+
+	for (bool verify : { true, false }) {
+		MMU* mmu = new MMU();
+		mmu->serialOutput = false;
+		mmu->load(file);
+		CPU* cpu = new CPU(mmu);
+		Jit* jit = new Jit(cpu, verify);
+		for (int frame = 0; frame < 10; frame++) jit->runFrame();
+		if (verify) CHECK(jit->mismatches == 0);
+		// Every pass of the loop has taken the interrupt, the frame may end
+		// between the handler and the loop counting
+		CHECK(mmu->memory[0xFF81] != 0);
+		CHECK(static_cast<uint8_t>(mmu->memory[0xFF80] - mmu->memory[0xFF81]) <= 1);
+		delete jit;
+		delete cpu;
+		delete mmu;
+	}
+	return failures;
+}
+
+// Code in the 0x4000 window switching that window must go on in the new bank
+static int testSwitchOwnBank() {
+	int failures = 0;
+	std::vector<uint8_t> rom(0x10000);
+	rom[0x147] = 0x01; // MBC1
+	rom[0x148] = 0x01; // 64 KB, 4 banks
+	place(rom, 0x100, { 0xC3, 0x50, 0x01 }); // JP 0150
+	place(rom, 0x150, {
+		0xAF,             // XOR A
+		0xEA, 0x01, 0xC0, // LD (C001),A
+		0x3E, 0x01,       // loop: LD A,1
+		0xEA, 0x00, 0x20, // LD (2000),A
+		0xCD, 0x00, 0x40, // CALL 4000
+		0x78,             // LD A,B
+		0xFE, 0x22,       // CP 22
+		0x28, 0x03,       // JR Z,+3
+		0xEA, 0x01, 0xC0, // LD (C001),A
+		0x18, 0xEE,       // JR loop
+	});
+	// Banks 1 and 2 both switch to bank 2, then load B with their own value
+	for (uint8_t bank : { 1, 2 }) {
+		place(rom, static_cast<uint16_t>(bank * 0x4000), {
+			0x3E, 0x02,       // LD A,2
+			0xEA, 0x00, 0x20, // LD (2000),A
+			0x06, static_cast<uint8_t>(bank * 0x11), // LD B,11 / LD B,22
+			0xC9,             // RET
+		});
+	}
+	std::string file = writeRom("jit_bank", rom);
+
+	for (int mode = 0; mode < 3; mode++) {
+		MMU* mmu = new MMU();
+		mmu->serialOutput = false;
+		mmu->load(file);
+		CPU* cpu = new CPU(mmu);
+		// Interpreter, then the JIT with and without verification
+		Jit* jit = mode > 0 ? new Jit(cpu, mode == 1) : NULL;
+		for (int frame = 0; frame < 4; frame++) {
+			if (jit != NULL) jit->runFrame();
+			else cpu->runFrame();
+		}
+		if (mode == 1) CHECK(jit->mismatches == 0);
+		CHECK(mmu->get(0xC001) == 0);
+		CHECK(cpu->B == 0x22);
+		delete jit;
+		delete cpu;
+		delete mmu;
+	}
+	return failures;
+}
+
+/*
+	Random bytes run as code touch nearly every opcode, IO register and
+	interrupt, so the JIT is checked against the interpreter one instruction
+	at a time. HALT and STOP are left out so the program never sleeps. The
+	ROM stays behind for the jit-verify test of gbemu-headless.
+*/
+static int testRandomProgram() {
+	int failures = 0;
+	std::mt19937 random(3);
+	std::vector<uint8_t> rom = blankRom();
+	for (uint8_t& byte : rom) {
+		byte = static_cast<uint8_t>(random());
+		if (byte == 0x76 || byte == 0x10) byte = 0x00;
+	}
+	place(rom, 0x100, { 0x00, 0xC3, 0x50, 0x01 }); // NOP; JP 0150
+	place(rom, 0x147, { 0x00, 0x00, 0x00 });       // No controller, 32 KB, no RAM
+	std::string file = writeRom("jit_random", rom);
+
+	MMU* mmu = new MMU();
+	mmu->serialOutput = false;
+	mmu->load(file);
+	CPU* cpu = new CPU(mmu);
+	Jit* jit = new Jit(cpu, true);
+	for (int frame = 0; frame < 5; frame++) jit->runFrame();
+	CHECK(jit->mismatches == 0);
+	delete jit;
+	delete cpu;
+	delete mmu;
+	return failures;
+}
+
+int main() {
+	return testEnableInterrupts() + testSwitchOwnBank() + testRandomProgram() > 0;
+}
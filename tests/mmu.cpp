@@ -0,0 +1,81 @@
+#include "testrom.h"
+#include "mmu.h"
+
+// MBC5 maps all 16 RAM banks of a 128 KB cartridge
+static int testMbc5RamBanks() {
+	int failures = 0;
+	std::vector<uint8_t> rom = blankRom();
+	rom[0x147] = 0x1A; // MBC5+RAM
+	rom[0x149] = 0x04; // 128 KB
+	MMU* mmu = new MMU();
+	mmu->load(writeRom("mbc5_ram", rom));
+	mmu->set(0x0000, 0x0A);
+	for (int bank = 0; bank < 16; bank++) {
+		mmu->set(0x4000, bank);
+		mmu->set(0xA000, 0x40 + bank);
+	}
+	for (int bank = 0; bank < 16; bank++) {
+		mmu->set(0x4000, bank);
+		CHECK(mmu->get(0xA000) == 0x40 + bank);
+	}
+	delete mmu;
+	return failures;
+}
+
+// MBC3 RAM banks 08-0C are the clock registers, not RAM
+static int testMbc3ClockRegisters() {
+	int failures = 0;
+	std::vector<uint8_t> rom = blankRom();
+	rom[0x147] = 0x12; // MBC3+RAM
+	rom[0x149] = 0x03; // 32 KB
+	MMU* mmu = new MMU();
+	mmu->load(writeRom("mbc3_clock", rom));
+	mmu->set(0x0000, 0x0A);
+	mmu->set(0x4000, 0x00);
+	mmu->set(0xA000, 0x11);
+	mmu->set(0x4000, 0x08);
+	mmu->set(0xA000, 0x22);
+	CHECK(mmu->get(0xA000) == 0x22);
+	mmu->set(0x4000, 0x00);
+	CHECK(mmu->get(0xA000) == 0x11);
+	delete mmu;
+	return failures;
+}
+
+// DIV counts every 64 M-cycles from its last reset without any event
+static int testDivider() {
+	int failures = 0;
+	MMU* mmu = new MMU();
+	mmu->scheduler.now = 64 * 10 + 3;
+	CHECK(mmu->get(0xFF04) == 10);
+	mmu->set(0xFF04, 0x55);
+	CHECK(mmu->get(0xFF04) == 0);
+	mmu->scheduler.now += 63;
+	CHECK(mmu->get(0xFF04) == 0);
+	mmu->scheduler.now += 64 * 256 + 1;
+	CHECK(mmu->get(0xFF04) == 1);
+	delete mmu;
+	return failures;
+}
+
+// HRAM skips the IO handlers, IE and watchpoints still go through them
+static int testHram() {
+	int failures = 0;
+	MMU* mmu = new MMU();
+	mmu->set(0xFF90, 0x12);
+	CHECK(mmu->get(0xFF90) == 0x12);
+	mmu->interruptsChanged = false;
+	mmu->set(0xFFFF, 0x01);
+	CHECK(mmu->interruptsChanged);
+	mmu->setWatchpoint(0xFF90, false, true);
+	mmu->set(0xFF90, 0x34);
+	CHECK(mmu->watchpointHit);
+	CHECK(mmu->watchpointAddress == 0xFF90);
+	CHECK(mmu->get(0xFF90) == 0x34);
+	delete mmu;
+	return failures;
+}
+
+int main() {
+	return testMbc5RamBanks() + testMbc3ClockRegisters() + testDivider() + testHram() > 0;
+}
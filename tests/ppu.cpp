@@ -0,0 +1,76 @@
+#include "testrom.h"
+#include "mmu.h"
+#include "cpu.h"
+#include "ppu.h"
+
+const uint8_t TEST_LINE = 5;
+const uint64_t LINE_START = 1000;
+
+/*
+	Draws one line with the FIFO renderer while a register is written 
+	during mode 3, either by the CPU running code at pc from time on or 
+	directly through the MMU at time.
+*/
+static std::vector<uint16_t> drawLine(const std::string& rom, uint16_t pc, uint64_t time, uint16_t address, uint8_t value) {
+	MMU* mmu = new MMU();
+	mmu->serialOutput = false;
+	mmu->load(rom);
+	PPU* ppu = new PPU(mmu);
+	ppu->attach<FifoRenderer>();
+	CPU* cpu = new CPU(mmu);
+	// The line is driven by hand, not by the LCD events
+	mmu->scheduler.cancel(EVENT_LINE);
+	mmu->scheduler.cancel(EVENT_MODE);
+	// Tile 0 alternates colours 3 and 0 every two pixels, the map 
+	// alternates it with the blank tile 1
+	for (int i = 0; i < 16; i++) mmu->set(0x8000 + i, 0xCC);
+	for (int i = 0; i < 32; i++) mmu->set(0x9800 + i, i & 1);
+	mmu->memory[0xFF40] = 0x91;
+	mmu->memory[0xFF43] = 0x00;
+	mmu->memory[0xFF47] = 0xE4;
+
+	mmu->scheduler.now = LINE_START;
+	ppu->startLine(TEST_LINE, LINE_START);
+	mmu->scheduler.now = time;
+	if (pc != 0) {
+		cpu->pc = pc;
+		cpu->A = value;
+		cpu->C = address & 0xFF;
+		cpu->cycleBudget = 100;
+		cpu->execute(1);
+	}
+	else {
+		mmu->set(address, value);
+	}
+	ppu->endLine();
+	ppu->finishFrame();
+	std::vector<uint16_t> line(ppu->frame() + TEST_LINE * GB_WIDTH, ppu->frame() + (TEST_LINE + 1) * GB_WIDTH);
+	delete cpu;
+	delete ppu;
+	delete mmu;
+	return line;
+}
+
+// The PPU sees a register write at the M-cycle the instruction performs it in
+static int testMidLineWrites() {
+	int failures = 0;
+	std::vector<uint8_t> rom = blankRom();
+	place(rom, 0x150, { 0xE0, 0x47 }); // LDH (BGP),A, writes in its 3rd M-cycle
+	place(rom, 0x160, { 0xE0, 0x43 }); // LDH (SCX),A
+	place(rom, 0x170, { 0xE2 });       // LD (C),A, writes in its 2nd M-cycle
+	std::string file = writeRom("mid_line", rom);
+
+	uint64_t time = LINE_START + 20;
+	// Two M-cycles later is eight dots, which moves both splits
+	CHECK(drawLine(file, 0, time, 0xFF47, 0x1B) != drawLine(file, 0, time + 2, 0xFF47, 0x1B));
+	CHECK(drawLine(file, 0, time, 0xFF43, 0x08) != drawLine(file, 0, time + 2, 0xFF43, 0x08));
+	CHECK(drawLine(file, 0x150, time, 0xFF47, 0x1B) == drawLine(file, 0, time + 2, 0xFF47, 0x1B));
+	CHECK(drawLine(file, 0x160, time, 0xFF43, 0x08) == drawLine(file, 0, time + 2, 0xFF43, 0x08));
+	CHECK(drawLine(file, 0x170, time, 0xFF47, 0x1B) == drawLine(file, 0, time + 1, 0xFF47, 0x1B));
+	CHECK(drawLine(file, 0x170, time, 0xFF43, 0x08) == drawLine(file, 0, time + 1, 0xFF43, 0x08));
+	return failures;
+}
+
+int main() {
+	return testMidLineWrites() > 0;
+}
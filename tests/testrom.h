@@ -0,0 +1,33 @@
+#pragma once
+#include "definitions.h"
+
+#include <cstdio>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+/*
+	Helpers for the regression tests: each test assembles a tiny ROM-only
+	cartridge, writes it next to the test binary and runs it headless.
+	CHECK counts failures in a local `failures`, which main returns.
+*/
+#define CHECK(condition) \
+	do { if (!(condition)) { std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); failures++; } } while (0)
+
+// 32 KB image, NOPs everywhere and no controller in the header
+inline std::vector<uint8_t> blankRom() {
+	return std::vector<uint8_t>(0x8000);
+}
+
+inline void place(std::vector<uint8_t>& rom, uint16_t address, std::initializer_list<uint8_t> code) {
+	for (uint8_t byte : code) rom[address++] = byte;
+}
+
+inline std::string writeRom(const std::string& name, const std::vector<uint8_t>& rom) {
+	std::string file = name + ".gb";
+	FILE* out = std::fopen(file.c_str(), "wb");
+	if (out == NULL) return file;
+	std::fwrite(rom.data(), 1, rom.size(), out);
+	std::fclose(out);
+	return file;
+}